@@ -1,8 +1,10 @@
+// every particle is drawn at the same size, set once per draw
+uniform float pointSize;
+
 void main() {
 
     gl_Position   = gl_ModelViewProjectionMatrix * gl_Vertex;
-	float size    = gl_Normal.x;
-    gl_PointSize  = size;
+    gl_PointSize  = pointSize;
     gl_FrontColor = gl_Color;
 
 }
\ No newline at end of file
@@ -1,8 +1,18 @@
+// every particle is drawn at the same size, set once per draw
+uniform float pointSize;
+
+// set by the programmable renderer, the positions come from
+// ParticleStreamBuffer as the "position" attribute
+uniform mat4 modelViewProjectionMatrix;
+uniform vec4 globalColor;
+attribute vec4 position;
+
+varying vec4 color;
+
 void main() {
 
-    gl_Position   = gl_ModelViewProjectionMatrix * gl_Vertex;
-	float size    = gl_Normal.x;
-    gl_PointSize  = size;
-    gl_FrontColor = gl_Color;
+    gl_Position   = modelViewProjectionMatrix * position;
+    gl_PointSize  = pointSize;
+    color         = globalColor;
 
 }
\ No newline at end of file
@@ -1,8 +1,78 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "sim/Headless.h"
+#include "sim/Batch.h"
+#include "sim/MeshCache.h"
+#include "sim/SelfCheck.h"
+#include "render/ImpostorCheck.h"
+#include "render/StreamCheck.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char *argv[]){
+
+	// --headless [steps]: run the simulation without a window and report
+	// how fast it goes
+	//
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "--headless") {
+			return runHeadless((i + 1 < argc) ? atoi(argv[i + 1]) : 100000);
+		}
+
+		// --batch [runs] [file.csv]: Monte-Carlo runs of many landers with
+		// randomized ship constants, see sim/Batch.h
+		//
+		if (string(argv[i]) == "--batch") {
+			int runs = (i + 1 < argc) ? atoi(argv[i + 1]) : 1000;
+			return runBatch(runs, (i + 2 < argc) ? argv[i + 2] : "");
+		}
+
+		// --replay file.inputs [file.flr]: fly the inputs logged by a game
+		// again without a window, see sim/InputLog.h
+		//
+		if (string(argv[i]) == "--replay" && i + 1 < argc) {
+			return runReplay(argv[i + 1], (i + 2 < argc) ? argv[i + 2] : "");
+		}
+
+		// --mesh-cache file.obj ...: write the binary caches of the given
+		// meshes ahead of the first run, see sim/MeshCache.h
+		//
+		if (string(argv[i]) == "--mesh-cache") {
+			bool ok = i + 1 < argc;
+			for (int k = i + 1; k < argc; k++) ok = buildMeshCache(argv[k]) && ok;
+			return ok ? 0 : 1;
+		}
+
+		// --terrain-lod file.obj ...: build the levels of detail of the
+		// given terrains ahead of the first run, see sim/TerrainLod.h
+		//
+		if (string(argv[i]) == "--terrain-lod") {
+			bool ok = i + 1 < argc;
+			for (int k = i + 1; k < argc; k++) ok = TerrainLod::build(argv[k]) && ok;
+			return ok ? 0 : 1;
+		}
+
+		// --self-check: checks of the engine that need no window, see
+		// sim/SelfCheck.h
+		//
+		if (string(argv[i]) == "--self-check") {
+			return runSelfCheck();
+		}
+
+		// --impostor-check [spheres]: draw particles as sphere impostors and
+		// as spheres and compare, see render/ImpostorCheck.h
+		//
+		if (string(argv[i]) == "--impostor-check") {
+			return runImpostorCheck((i + 1 < argc) ? atoi(argv[i + 1]) : 20000);
+		}
+
+		// --stream-check: draw points through both paths of the particle
+		// stream buffer and read them back, see render/StreamCheck.h
+		//
+		if (string(argv[i]) == "--stream-check") {
+			return runStreamCheck();
+		}
+	}
+
 	ofSetupOpenGL(1280, 1024,OF_WINDOW);			// <-------- setup the GL context
 
 	// this kicks off the running of my app
@@ -3,6 +3,7 @@
 
 
 #include "Octree.h"
+#include "../utils/Profiler.h"
  
 
 // draw Octree (recursively)
@@ -69,6 +70,17 @@ Box Octree::meshBounds(const ofMesh & mesh) {
 	return Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
 }
 
+static void leafExtent(const TreeNode &node, float &height, float &diagonalXZ) {
+	if (node.children.size() == 0) {
+		Vector3 size = node.box.parameters[1] - node.box.parameters[0];
+		height = std::max(height, size.y());
+		diagonalXZ = std::max(diagonalXZ, sqrtf(size.x() * size.x() + size.z() * size.z()));
+	}
+	for (unsigned int i = 0; i < node.children.size(); i++) {
+		leafExtent(node.children[i], height, diagonalXZ);
+	}
+}
+
 // getMeshPointsInBox:  return an array of indices to points in mesh that are contained 
 //                      inside the Box.  Return count of points found;
 //
@@ -121,6 +133,8 @@ void Octree::subDivideBox8(const Box &box, vector<Box> & boxList) {
 }
 
 void Octree::create(const ofMesh & geo, int numLevels) {
+	PROFILE_ZONE("Octree::create");
+
 	// initialize octree structure
 	//
 	mesh = geo;
@@ -133,6 +147,9 @@ void Octree::create(const ofMesh & geo, int numLevels) {
 
 	subdivide(mesh, root, numLevels, 0);
 
+	leafHeight = leafDiagonalXZ = 0;
+	leafExtent(root, leafHeight, leafDiagonalXZ);
+
 }
 
 void Octree::subdivide(const ofMesh & mesh, TreeNode & node, int numLevels, int level) {
@@ -158,7 +175,7 @@ void Octree::subdivide(const ofMesh & mesh, TreeNode & node, int numLevels, int
 }
 
 // for collision checking
-bool Octree::intersect(const ofVec3f & vec, const TreeNode & node, TreeNode & nodeRtn) {
+bool Octree::intersect(const ofVec3f & vec, const TreeNode & node, TreeNode & nodeRtn) const {
 	ofVec3f v = vec;
 	if (node.box.inside(Vector3(v.x, v.y, v.z))) {
 		// at leaf node
@@ -179,7 +196,7 @@ bool Octree::intersect(const ofVec3f & vec, const TreeNode & node, TreeNode & no
 }
 
 // For checking if selection intersected more than one point
-bool Octree::intersect(const Ray &ray, const TreeNode & node, vector<TreeNode> & nodeIntersected) {
+bool Octree::intersect(const Ray &ray, const TreeNode & node, vector<TreeNode> & nodeIntersected) const {
 	if (node.box.intersect(ray, -1000, 1000)) {
 		// at leaf node
 
@@ -201,7 +218,7 @@ bool Octree::intersect(const Ray &ray, const TreeNode & node, vector<TreeNode> &
 }
 
 // For altitude checking
-bool Octree::intersect(const Ray &ray, const TreeNode & node, TreeNode & nodeRtn) {
+bool Octree::intersect(const Ray &ray, const TreeNode & node, TreeNode & nodeRtn) const {
 	if (node.box.intersect(ray, -1000, 1000)) {
 		// at leaf node
 		if (node.children.size() == 0) {
@@ -11,14 +11,18 @@ public:
 	vector<TreeNode> children;
 };
 
+//  The queries (intersect) are const and only read the tree, so once
+//  create() has returned any number of threads may query one Octree at
+//  the same time.
+//
 class Octree {
 public:
 	
 	void create(const ofMesh & mesh, int numLevels);
 	void subdivide(const ofMesh & mesh, TreeNode & node, int numLevels, int level);
-	bool intersect(const ofVec3f &, const TreeNode & node, TreeNode & nodeRtn);
-	bool intersect(const Ray &, const TreeNode &, vector<TreeNode> &);
-	bool intersect(const Ray &, const TreeNode &, TreeNode &);
+	bool intersect(const ofVec3f &, const TreeNode & node, TreeNode & nodeRtn) const;
+	bool intersect(const Ray &, const TreeNode &, vector<TreeNode> &) const;
+	bool intersect(const Ray &, const TreeNode &, TreeNode &) const;
 
 	void draw(TreeNode & node, int numLevels, int level);
 	void draw(int numLevels, int level) {
@@ -28,11 +32,18 @@ public:
 	void drawLeafNodes() { drawLeafNodes(root); };
 	static void drawBox(const Box &box);
 	static Box meshBounds(const ofMesh &);
+
 	int getMeshPointsInBox(const ofMesh &mesh, const vector<int> & points, Box & box, vector<int> & pointsRtn);
 	void subDivideBox8(const Box &b, vector<Box> & boxList);
 
 	ofMesh mesh;
 	TreeNode root;
+
+	// largest height and largest diagonal over x and z of the leaf boxes,
+	// set by create(): a point inside a leaf is at most that high above,
+	// and that far to the side of, a vertex of the mesh
+	float leafHeight = 0;
+	float leafDiagonalXZ = 0;
 	
 
 	const ofColor colors[10]{ ofColor::red, ofColor::green, ofColor::blue, ofColor::yellow,
@@ -27,11 +27,36 @@
 	hanging must be enabled to use Mouse control
 	click on mesh, the lander will head to that dir.
 
+	Space starts the game.  Every game is recorded to data/flight-<time>.flr
+	and its inputs logged to data/flight-<time>.inputs, which
+	"--replay flight-<time>.inputs" flies again (see sim/InputLog.h).
+
+	S saves data/screenshot-<time>.png
+	Shift S starts and stops capturing every frame to data/capture-<time>/
+
+	T switches between the terrain levels of detail and the full mesh
+
+	I prints a comparison of the integrators (see IntegratorHarness.h)
+
+	Profiler (debug builds, see utils/Profiler.h):
+	P shows the frame profile
+	Shift P writes the last frames to data/profile-<time>.csv and .json
+
 */
 
 
 #include "ofApp.h"
+#include "particle/IntegratorHarness.h"
 #include "utils/Util.h"
+#include "utils/Profiler.h"
+#include "sim/MeshCache.h"
+
+// the clock of the lander inputs, sec.  The simulation is advanced to it
+// every frame, see LanderSim::queueInput().
+//
+static double simWallTime() {
+	return ofGetElapsedTimeMicros() / 1.0e6;
+}
 
 
 
@@ -40,34 +65,6 @@
 //
 void ofApp::setup(){
 
-	// Load Font
-	if (!menuFont.load(fontPath, 100)) cout << "missing font" << endl;
-
-
-		// texture loading
-	//
-	ofDisableArbTex();     // disable rectangular textures
-
-	// load textures
-	//
-	if (!ofLoadImage(particleTex, "images/dot.png")) {
-		cout << "Particle Texture File: images/dot.png not found" << endl;
-		ofExit();
-	}
-
-	// load shader
-#ifdef TARGET_OPENGLES
-	shader.load("shaders_gles/shader");
-#else
-	shader.load("shaders/shader");
-#endif
-
-	// load sound
-	if (!thrusterSound.load("sound/rocket-thrust-effect.wav")) {
-		cout << "no sound file found" << endl;
-		ofExit();
-	}
-
 	// load light
 	pointLight.setup();
 	pointLight.enable();
@@ -104,75 +101,91 @@ void ofApp::setup(){
 	//
 	initLightingAndMaterials();
 
-	if (moon.loadModel(moonPath)) {
-		cout << "loading moon model" << endl;
-		moon.setRotation(0, 180, 0, 0, 1);
-		moon.setScaleNormalization(false);
-		cout << "complete loading moon model" << endl;
+	ofDisableArbTex();     // disable rectangular textures
 
-		cout << "creating octree" << endl;
-		octree.create(moon.getMesh(0), levels);
-		cout << "complete creating octree" << endl;
-	}
-	else {
-		cout << "Error Can't load moon model" << endl;
-		ofExit(0);
-	}
+	// everything else loads in the background (see AsyncLoader.h), the
+	// first frame does not wait for it.  Files are parsed and decoded on
+	// worker threads, GL objects are made on this thread in update().
+	//
+	loader.add("font", nullptr, [this]() {
+		if (!menuFont.load(fontPath, 100)) cout << "missing font" << endl;
+		return true;
+	});
+
+	loader.add("particle texture",
+		[this]() { return ofLoadImage(particlePixels, "images/dot.png"); },
+		[this]() {
+			particleTex.loadData(particlePixels);
+			return true;
+		});
+
+	loader.add("shader", nullptr, [this]() {
+#ifdef TARGET_OPENGLES
+		return shader.load("shaders_gles/shader");
+#else
+		return shader.load("shaders/shader");
+#endif
+	});
 
-	// load lander
-	if (lander.loadModel(landerPath)) {
-		cout << "loading lander" << endl;
+	loader.add("sound", nullptr, [this]() { return thrusterSound.load("sound/rocket-thrust-effect.wav"); });
+
+	// the terrain is drawn from its own vbo as soon as it is parsed, the
+	// octree is built from the same mesh in the meantime
+	//
+	int terrainJob = loader.add("terrain",
+		[this]() { return loadMeshCached(moonPath, terrainMesh); },
+		[this]() {
+			terrain = terrainMesh;
+			bTerrainLoaded = true;
+			return true;
+		});
+
+	int lodJob = loader.add("terrain lod",
+		[this]() { return terrainLod.load(moonPath, terrainMesh); },
+		[this]() {
+			terrainRenderer.setup(terrainMesh, terrainLod);
+			return true;
+		},
+		{ terrainJob });
+
+	loader.add("lander", nullptr, [this]() {
+		if (!lander.loadModel(landerPath)) return false;
 		lander.setScaleNormalization(false);
-		
 		lander.setScale(1, 1, 1);
-		lander.setPosition(-110,35,0);
+		lander.setPosition(landerStart.x, landerStart.y, landerStart.z);
 		lander.setRotation(0, 180, 0, 0, 1);
-
 		bRoverLoaded = true;
-
-		cout << "complete loading lander" << endl;
 		cout << "lander position: " << lander.getPosition() << endl;
-	}
-	else {
-		cout << "Error Can't load lander model" << endl;
-		ofExit(0);
-	}
-	// Set up ship particle system
-	shipsys = new ParticleSystem();
-	core = new Particle();
-	core->lifespan = INFINITY;
-	core->mass = 1;
-	core->position = lander.getPosition();
-	shipsys->add(*core);
-	shipsys->addForce(new TurbulenceForce(turbMin, turbMax));
-	// Since add/push_back creates a copy of the particle, I need to reset what it points to.
-	core = &(shipsys->particles[0]);
-
-	// create emitter and add forces
-	shipsys->addForce(new Thruster());
-	shipsys->addForce(new GravityForce(gravityF));
-	shipsys->addForce(new ImpulseForce()); // for stopping the lander // at index 3
-	shipsys->addForce(new GravityForce(zeroVec));
-	shipsys->addForce(new Thruster());
-	shipsys->addForce(new Thruster());
-	turbulanceForce = (TurbulenceForce *)(shipsys->forces[0]);
-	thrusterForce = (Thruster *)(shipsys->forces[1]); 
-	moonGravity = (GravityForce *)(shipsys->forces[2]);
-	impulseForce = (ImpulseForce *)(shipsys->forces[3]);
-	supportGravityForce = (GravityForce *)(shipsys->forces[4]);
-	hangingForce = (Thruster *)(shipsys->forces[5]);
-	autoPilotForce = (Thruster *)(shipsys->forces[6]);
-
-	emitter = new ParticleEmitter();
-	emitter->setEmitterType(DiscEmitter);
-	emitter->setOneShot(true);
-	emitter->setGroupSize(50);
-	emitter->particleColor = ofColor::yellow;
-	emitter->particleRadius = 0.02f;
-	emitter->setLifespanRange(ofVec2f(0.1, 0.5));
-	emitter->setRandomLife(true);
-	emitter->setVelocity(ofVec3f(0, 7, 0));
-	emitter->sys->addForce(new TurbulenceForce(ofVec3f(-5, 0, -5), ofVec3f(5, 0, 5)));
+		return true;
+	});
+
+	// build the simulation over the terrain, with the lander where the
+	// model is placed
+	//
+	int octreeJob = loader.add("octree",
+		[this]() {
+			sim.setup(terrainMesh, landerStart, levels);
+			return true;
+		},
+		[this]() {
+			bSimReady = true;
+			return true;
+		},
+		{ terrainJob });
+
+	// skip the octree for landers well above the coarse levels of the
+	// terrain, see LanderSim::setBroadPhase()
+	//
+	loader.add("broad phase",
+		[this]() {
+			terrainLod.setBroadPhase(broadPhaseLevel, sim.ground->leafDiagonalXZ);
+			return true;
+		},
+		[this]() {
+			sim.setBroadPhase(&terrainLod);
+			return true;
+		},
+		{ octreeJob, lodJob });
 
 	// by default set to full screen
 	ofSetFullscreen(true);
@@ -182,117 +195,46 @@ void ofApp::setup(){
 //--------------------------------------------------------------
 
 void ofApp::update() {
-	if (isGameStart) {
-		frontCam.setPosition(glm::vec3(core->position.x, core->position.y + 2.0f, core->position.z));
-		bottomCam.setPosition(core->position);
-		trackCam.lookAt(bottomCam, glm::vec3(0,1,0));
-		lander.setPosition(core->position.x, core->position.y, core->position.z);
-
-		emitter->setPosition(ofVec3f(core->position.x, core->position.y + 0.5f, core->position.z));
 
-		if (startEmitter) {
-			emitter->start();
-		}
-		else {
-			emitter->stop();
-		}
-
-		// calculate altitude
-		// might combine collision calculation and altitude calculation to one calculation
-		Ray ray = Ray(Vector3(core->position.x, core->position.y, core->position.z),
-			Vector3(0, -1, 0)); // since it always points down
-		TreeNode altitudeNode;
-		if (octree.intersect(ray, octree.root, altitudeNode)) {
-			altitude = glm::length(octree.mesh.getVertex(altitudeNode.points[0]) - glm::vec3(core->position));
-
-		}
-
-		TreeNode intersectedNode;
-		//turbulanceForce->set(zeroVec, zeroVec);
-
-		// lander touches the ground
-		if (!completeStopped && octree.intersect(core->position, octree.root, intersectedNode)) {
-			groundTouched = true;
-			//cout << "intersected" << endl;
-			glm::vec3 vec = glm::vec3(core->velocity);
-
-			impulseForce->set(ofGetFrameRate() * -1 * vec,
-				octree.mesh.getNormal(intersectedNode.points[0]), materialRestitution);
-
-			turbulanceForce->set(zeroVec, zeroVec);
-
-			//supportGravityForce->set(OppositeGravityF);
-		}
-		else if(completeStopped){
-			groundTouched = true;
-		}
-		else {
-			groundTouched = false;
-			// HANGING
-			// thrustforce equals to gravity so that it stays in space.
-			if (hanging) {
-				//bruteforce approach
-				core->velocity.y = 0;
-				hangingForce->set(ofVec3f(0, 1, 0), moonGravityMag);
-				
-				if (b_selectedNode) {
-					
-					//core->reset();
-					ofVec3f toSelected = selectedVertex - core->position;
-					float distanceXZ = ofVec2f(toSelected.x, toSelected.z).length();
-					ofVec3f dir = toSelected.normalize();
-					//cout << distanceXZ << endl;
-					if (distanceXZ >= 0 && distanceXZ <= 2) {
-						core->reset();
-						autoPilotForce->set(zeroVec, 0);
-
-					}
-					else {
-						autoPilotForce->set(ofVec3f(dir.x, 0, dir.z), autoPilotMag);
-					}
-				}
-				else {
-					autoPilotForce->set(zeroVec, 0);
-
-				}
-			}
-			else {
-				hangingForce->set(zeroVec, 0);
-			}
-			
+	// a frame runs from one update to the next, draw included
+	//
+	PROFILE_END_FRAME();
+	PROFILE_BEGIN_FRAME();
+	PROFILE_ZONE("ofApp::update");
+
+	if (!loader.isFinished()) {
+		PROFILE_ZONE("loading");
+		loader.update();
+		if (loader.hasFailed()) {
+			cout << "loading failed:" << endl << loader.getReport();
+			ofExit();
 		}
+	}
 
-		// If below a certain altitude it is "touching" the ground.
-		if (groundTouched) {
-			supportGravityForce->set(OppositeGravityF);
-		}
-		else {
-			supportGravityForce->set(zeroVec);
-		}
+	if (isGameStart) {
 
-		emitter->update();
-		shipsys->update();
+		// run as many fixed steps as the elapsed frame time asks for
+		//
+		ParticleBudget &budget = ParticleBudget::shared();
+		budget.beginFrame();
+		sim.advanceTo(simWallTime());
+		budget.endFrame();
+
+		// interpolate the rendered lander between the last two steps
+		//
+		ofVec3f renderPos = sim.renderPosition();
+		frontCam.setPosition(glm::vec3(renderPos.x, renderPos.y + 2.0f, renderPos.z));
+		bottomCam.setPosition(renderPos);
+		trackCam.lookAt(bottomCam, glm::vec3(0,1,0));
+		lander.setPosition(renderPos.x, renderPos.y, renderPos.z);
 
-		// Since the velocity will always not equal to 0
-		// it is necessary to specify what zero is.
-		//cout << core->velocity << endl;
-		//cout << "groundTouched: " << groundTouched << "   ";
-		//cout << "completeStopped: " << completeStopped << endl;
 		playRocketThrusterEffect();
-
-		if (groundTouched && (core->velocity.y <= 0.025f && core->velocity.y >= -0.025f)) {
-			//cout << "velocity: " << core->velocity.y << endl;
-			shipsys->toggleOnOff(false);
-			
-			completeStopped = true;
-		}
-		
-		
 	}
 }
+
 //--------------------------------------------------------------
 void ofApp::draw(){
-	
+	PROFILE_ZONE("ofApp::draw");
 
 	ofBackground(ofColor::black);
 
@@ -304,9 +246,10 @@ void ofApp::draw(){
 	//pointLight.draw();
 
 	if (bWireframe) {                    // wireframe mode  (include axis)
+		PROFILE_ZONE("terrain draw");
 		ofDisableLighting();
 		ofSetColor(ofColor::slateGray);
-		moon.drawWireframe();
+		if (bTerrainLoaded) drawTerrain(true);
 		if (bRoverLoaded) {
 			lander.drawWireframe();
 			if (!bTerrainSelected) drawAxis(lander.getPosition());
@@ -314,8 +257,10 @@ void ofApp::draw(){
 		if (bTerrainSelected) drawAxis(ofVec3f(0, 0, 0));
 	}
 	else {
+		PROFILE_ZONE("terrain draw");
 		ofEnableLighting();              // shaded mode
-		moon.drawFaces();
+		ofSetColor(ofColor::white);
+		if (bTerrainLoaded) drawTerrain(false);
 
 		if (bRoverLoaded) {
 			lander.drawFaces();
@@ -325,52 +270,58 @@ void ofApp::draw(){
 	}
 
 
-	if (bDisplayPoints) {                // display points as an option    
+	if (bDisplayPoints && bTerrainLoaded) {     // display points as an option    
 		glPointSize(3);
 		ofSetColor(ofColor::green);
-		moon.drawVertices();
+		terrain.drawVertices();
 	}
 
 	ofNoFill();
 	//ofSetColor(ofColor::white);
 	
-	if (bdrawOctree) {
-		octree.draw(drawlevels,0);
+	if (bdrawOctree && bSimReady) {
+		sim.octree.draw(drawlevels,0);
 	}
-	else if (bdrawLeaf) {
-		octree.drawLeafNodes();
+	else if (bdrawLeaf && bSimReady) {
+		sim.octree.drawLeafNodes();
 	}
 
 	// draw the sphere
-	if (b_selectedNode) {
+	if (sim.b_selectedNode) {
 		ofSetColor(ofColor::yellow);
-		ofDrawSphere(selectedVertex, 5);
+		ofDrawSphere(sim.selectedVertex, 5);
 	}
 
 	//------------------------
 	//draw the emitter particle
 
-	loadVbo();
-	ofSetColor(ofColor::yellow);
+	// the particles need the shader, the texture and the simulation
+	//
+	if (loader.isFinished()) {
+		loadVbo();
+		ofSetColor(ofColor::yellow);
 
-	glDepthMask(GL_FALSE);
-	ofEnableBlendMode(OF_BLENDMODE_ADD);
-	ofEnablePointSprites();
-	ofEnableAlphaBlending();
+		PROFILE_ZONE("particle draw");
+		glDepthMask(GL_FALSE);
+		ofEnableBlendMode(OF_BLENDMODE_ADD);
+		ofEnablePointSprites();
+		ofEnableAlphaBlending();
 
-	shader.begin();
+		shader.begin();
+		shader.setUniform1f("pointSize", particleRadius);
 	
-	//emitter->draw();
-	particleTex.bind();
-	vbo.draw(GL_POINTS, 0, (int)emitter->sys->particles.size());
-	particleTex.unbind();
+		//emitter->draw();
+		particleTex.bind();
+		particleBuffer.draw(GL_POINTS);
+		particleTex.unbind();
 
-	shader.end();
-	glDepthMask(GL_TRUE);
+		shader.end();
+		glDepthMask(GL_TRUE);
 
-	ofDisablePointSprites();
-	ofDisableBlendMode();
-	ofDisableAlphaBlending();
+		ofDisablePointSprites();
+		ofDisableBlendMode();
+		ofDisableAlphaBlending();
+	}
 
 	ofPopMatrix();
 
@@ -380,7 +331,10 @@ void ofApp::draw(){
 
   
 	string str; 
-	if (!isGameStart) {
+	if (!loader.isFinished()) {
+		drawLoadingScreen();
+	}
+	else if (!isGameStart) {
 		// Draw some states
 		str = "PRESS SPACEBAR TO START";
 		ofSetColor(ofColor::yellow);
@@ -389,11 +343,41 @@ void ofApp::draw(){
 	
 	
 	//str = "Frame Rate: " + std::to_string(ofGetFrameRate());
-	str = "Altitude: " + std::to_string(altitude);
+	str = "Altitude: " + std::to_string(sim.altitude);
 	ofSetColor(ofColor::white);
 	ofDrawBitmapString(str, ofGetWindowWidth() - 170, 15);
 
+	if (ParticleBudget::shared().isThrottling()) {
+		str = ParticleBudget::shared().getReport();
+		ofSetColor(ofColor::orange);
+		ofDrawBitmapString(str, 10, ofGetWindowHeight() - 10);
+	}
 
+#ifdef SPACE_LANDER_PROFILE
+	Profiler::shared().draw(10, 20);
+#endif
+
+	// last, so the captures show the whole frame
+	//
+	frameCapture.capture();
+}
+
+// progress bar and the state of every loading job, drawn over whatever
+// has loaded so far
+//
+void ofApp::drawLoadingScreen() {
+	float w = ofGetWindowWidth() / 3.0f;
+	float x = 30;
+	float y = ofGetWindowHeight() / 2 - 50;
+
+	ofSetColor(ofColor::yellow);
+	ofNoFill();
+	ofDrawRectangle(x, y, w, 16);
+	ofFill();
+	ofDrawRectangle(x, y, w * loader.getProgress(), 16);
+
+	ofSetColor(ofColor::white);
+	ofDrawBitmapString("LOADING\n\n" + loader.getReport(), x, y + 40);
 }
 
 // 
@@ -424,7 +408,27 @@ void ofApp::drawAxis(ofVec3f location) {
 }
 
 
+// arrow key going down or up, with Ctrl for the forward/back thrusters
+//
+void ofApp::queueLanderKey(int key, int type) {
+	LanderInput input;
+	input.type = (uint8_t)type;
+	input.control = (key == OF_KEY_UP) ? LanderInput::Up : (key == OF_KEY_DOWN) ? LanderInput::Down :
+		(key == OF_KEY_LEFT) ? LanderInput::Left : LanderInput::Right;
+	input.modifiers = bCtrlKeyDown ? LanderInput::Ctrl : 0;
+	sim.queueInput(input, simWallTime());
+}
+
+// keys that fly the lander or start the game, ignored until the
+// simulation has loaded
+//
+static bool isLanderKey(int key) {
+	return key == OF_KEY_UP || key == OF_KEY_DOWN || key == OF_KEY_LEFT || key == OF_KEY_RIGHT ||
+		key == 'h' || key == ' ';
+}
+
 void ofApp::keyPressed(int key) {
+	if (!bSimReady && isLanderKey(key)) return;
 
 	switch (key) {
 	case 'C':
@@ -447,9 +451,16 @@ void ofApp::keyPressed(int key) {
 	case 's':
 		savePicture();
 		break;
+	case 'S':
+		if (frameCapture.isRecording()) frameCapture.stopSequence();
+		else frameCapture.startSequence("capture-" + ofGetTimestampString());
+		break;
 	case 't':
 		setCameraTarget();
 		break;
+	case 'T':
+		bTerrainLod = !bTerrainLod;
+		break;
 	case 'u':
 		break;
 	case 'v':
@@ -471,29 +482,12 @@ void ofApp::keyPressed(int key) {
 		break;
 	case OF_KEY_DEL:
 		break;
-	// lander control
+	// lander control, applied by the simulation step the key went down in
 	case OF_KEY_UP:
-		if (bCtrlKeyDown && (!groundTouched || !completeStopped || !hanging)) thrusterForce->set(ofVec3f(0, 0, 1), thrusterMag);
-		else if (!hanging) {
-			thrusterForce->set(ofVec3f(0, 1, 0), thrusterMag);
-
-			startEmitter = true;
-		}
-		groundTouched = false; 
-		completeStopped = false;
-		shipsys->toggleOnOff(true); // turn on system
-		break;
 	case OF_KEY_DOWN:
-		if (bCtrlKeyDown && (!groundTouched || !completeStopped || !hanging)) thrusterForce->set(ofVec3f(0, 0, -1), thrusterMag);
-		else if(!groundTouched || !completeStopped) thrusterForce->set(ofVec3f(0, -1, 0), thrusterMag);
-		break;
 	case OF_KEY_LEFT:
-		if (!groundTouched || !completeStopped || !hanging)
-			thrusterForce->set(ofVec3f(-1, 0, 0), thrusterMag);
-		break;
 	case OF_KEY_RIGHT:
-		if (!groundTouched || !completeStopped || !hanging)
-			thrusterForce->set(ofVec3f(1, 0, 0), thrusterMag);
+		queueLanderKey(key, LanderInput::Press);
 		break;
 	default:
 		break;
@@ -513,21 +507,34 @@ void ofApp::togglePointsDisplay() {
 }
 
 void ofApp::keyReleased(int key) {
+	if (!bSimReady && isLanderKey(key)) return;
 
 	switch (key) {
 	case 'c':
 		if (mainCam.getMouseInputEnabled()) mainCam.disableMouseInput();
 		else mainCam.enableMouseInput();
 		break;
-	case 'h':
-		hanging = !hanging;
-		startEmitter = hanging;
-		b_selectedNode = false;
-		core->reset();
+	case 'h': {
+		LanderInput input;
+		input.type = LanderInput::ToggleHanging;
+		sim.queueInput(input, simWallTime());
 		break;
+	}
 	case 'i':
-		
+		printIntegratorReport(runIntegratorHarness());
+		break;
+#ifdef SPACE_LANDER_PROFILE
+	case 'p':
+		Profiler::shared().showHud = !Profiler::shared().showHud;
+		break;
+	case 'P': {
+		string name = "profile-" + ofGetTimestampString();
+		Profiler::shared().writeCsv(ofToDataPath(name + ".csv"));
+		Profiler::shared().writeTrace(ofToDataPath(name + ".json"));
+		cout << "profile written to " << name << ".csv / .json" << endl;
 		break;
+	}
+#endif
 	case OF_KEY_F1:
 		theCam = &mainCam;
 		break;
@@ -551,25 +558,18 @@ void ofApp::keyReleased(int key) {
 		break;
 	// when released up arrow key, stop the emitter 
 	case OF_KEY_UP:
-		
-		startEmitter = false;
-		thrusterForce->set(ofVec3f(0, 0, 0), 0);
-		
-		break;
 	case OF_KEY_DOWN:
-		
-		thrusterForce->set(ofVec3f(0, 0, 0), 0);
-		break;
 	case OF_KEY_LEFT:
-		
-		thrusterForce->set(ofVec3f(0, 0, 0), 0);
-		break;
 	case OF_KEY_RIGHT:
-		
-		thrusterForce->set(ofVec3f(0, 0, 0), 0);
+		queueLanderKey(key, LanderInput::Release);
 		break;
 	case ' ':
-		if (!isGameStart) isGameStart = true;
+		if (!isGameStart) {
+			isGameStart = true;
+			string name = "flight-" + ofGetTimestampString();
+			sim.recorder.start(ofToDataPath(name + ".flr"), sim.simClock.dt);
+			sim.inputLog.start(ofToDataPath(name + ".inputs"), sim.simClock.dt);
+		}
 		break;
 	default:
 		break;
@@ -587,38 +587,21 @@ void ofApp::mouseMoved(int x, int y ){
 //--------------------------------------------------------------
 void ofApp::mousePressed(int x, int y, int button) {
 	// works only if left click
-	if (hanging && button == 0) {
+	if (bSimReady && sim.hanging && button == 0) {
 		ofVec3f mouse(mouseX, mouseY);
 		ofVec3f rayPoint = theCam->screenToWorld(mouse);
 		ofVec3f rayDir = rayPoint - theCam->getPosition();
 		rayDir.normalize();
 		Ray ray = Ray(Vector3(rayPoint.x, rayPoint.y, rayPoint.z),
 			Vector3(rayDir.x, rayDir.y, rayDir.z));
-		float startTime = ofGetElapsedTimeMicros();
-		vector<TreeNode> listOfIntersected;
-
-		if (octree.intersect(ray, octree.root, listOfIntersected)) {
-			b_selectedNode = true;
-
-			// For selecting the closest point to the cam.
-			float closest = INT_MAX;
-			unsigned int closestIndex = 0;
-			for (unsigned int i = 0; i < listOfIntersected.size(); i++) {
-				glm::vec3 vertex = octree.mesh.getVertex(listOfIntersected[i].points[0]);
-				float distance = glm::length(vertex - theCam->getPosition());
-				//cout << "i: " << i << ", vertex: " << vertex << "distance from cam: " << distance << endl;
-				if (closest > distance) {
-					closest = distance;
-					closestIndex = i;
-				}
-
-			}
-			selectedVertex = octree.mesh.getVertex(listOfIntersected[closestIndex].points[0]);
-		}
-		else {
 
-			b_selectedNode = false;
-		}
+		// the target is looked up now, it is set by the step the click
+		// falls in
+		//
+		LanderInput input;
+		input.type = sim.findTarget(ray, theCam->getPosition(), input.target) ?
+			LanderInput::Target : LanderInput::ClearTarget;
+		sim.queueInput(input, simWallTime());
 	}
    
 }
@@ -704,11 +687,18 @@ void ofApp::initLightingAndMaterials() {
 	glShadeModel(GL_SMOOTH);
 } 
 
+// finish the flight recording on the way out
+//
+void ofApp::exit() {
+	sim.recorder.stop();
+	sim.inputLog.stop(sim.shipsys ? sim.shipsys->steps : 0);
+	frameCapture.close();
+}
+
 void ofApp::savePicture() {
-	ofImage picture;
-	picture.grabScreen(0, 0, ofGetWidth(), ofGetHeight());
-	picture.save("screenshot.png");
-	cout << "picture saved" << endl;
+	string name = "screenshot-" + ofGetTimestampString() + ".png";
+	frameCapture.screenshot(name);
+	cout << "saving " << name << endl;
 }
 
 //--------------------------------------------------------------
@@ -744,28 +734,26 @@ bool ofApp::mouseIntersectPlane(ofVec3f planePoint, ofVec3f planeNorm, ofVec3f &
 }
 
 
-// load vertex buffer in preparation for rendering
+// the terrain from the levels of detail the camera needs, or the full
+// mesh until they are loaded
 //
-void ofApp::loadVbo() {
-	if (emitter->sys->particles.size() < 1) return;
+void ofApp::drawTerrain(bool wireframe) {
+	if (bTerrainLod && terrainRenderer.isReady()) terrainRenderer.draw(*theCam, wireframe);
+	else if (wireframe) terrain.drawWireframe();
+	else terrain.drawFaces();
+}
 
-	vector<ofVec3f> sizes;
-	vector<ofVec3f> points;
-	for (int i = 0; i < emitter->sys->particles.size(); i++) {
-		points.push_back(emitter->sys->particles[i].position);
-		sizes.push_back(ofVec3f(particleRadius));
-	}
-	// upload the data to the vbo
-	//
-	int total = (int)points.size();
-	vbo.clear();
-	vbo.setVertexData(&points[0], total, GL_STATIC_DRAW);
-	vbo.setNormalData(&sizes[0], total, GL_STATIC_DRAW);
+// stream this frame's particle positions into the vertex buffer in
+// preparation for rendering
+//
+void ofApp::loadVbo() {
+	PROFILE_ZONE("loadVbo");
+	particleBuffer.upload(sim.exhaust.positions);
 }
 
 
 void ofApp:: playRocketThrusterEffect() {
-	if (startEmitter) {
+	if (sim.startEmitter) {
 		if (!thrusterSound.isPlaying()) {
 			thrusterSound.play();
 		}
@@ -4,9 +4,11 @@
 #include  "ofxAssimpModelLoader.h"
 #include "utils/box.h"
 #include "utils/ray.h"
-#include "Octree/Octree.h"
-#include "particle/ParticleSystem.h"
-#include "particle/ParticleEmitter.h"
+#include "sim/LanderSim.h"
+#include "render/ParticleStreamBuffer.h"
+#include "render/TerrainRenderer.h"
+#include "render/FrameCapture.h"
+#include "utils/AsyncLoader.h"
 
 
 
@@ -16,6 +18,7 @@ class ofApp : public ofBaseApp{
 		void setup();
 		void update();
 		void draw();
+		void exit();
 
 		void keyPressed(int key);
 		void keyReleased(int key);
@@ -37,6 +40,9 @@ class ofApp : public ofBaseApp{
 		void setCameraTarget();
 		void playRocketThrusterEffect();
 		void loadVbo();
+		void drawLoadingScreen();
+		void drawTerrain(bool wireframe);
+		void queueLanderKey(int key, int type);
 
 
 		//bool  doPointSelection(); // another way of selecting points
@@ -50,10 +56,25 @@ class ofApp : public ofBaseApp{
 		ofCamera frontCam;
 		ofCamera trackCam;
 		ofCamera *theCam;
-		ofxAssimpModelLoader moon, lander;
+		ofxAssimpModelLoader lander;
 		string moonPath = "geo/moon-houdini.obj";
 		string landerPath = "geo/lander.obj";
-		float altitude = 0;
+		ofVec3f landerStart = ofVec3f(-110, 35, 0);
+
+		// the moon, parsed on a loader thread and drawn from a vbo
+		ofMesh terrainMesh;
+		ofVboMesh terrain;
+		bool bTerrainLoaded = false;
+
+		// and its levels of detail, drawn instead once they are loaded (T
+		// toggles back to the full mesh).  They also give the simulation a
+		// broad phase for its ground queries.
+		TerrainLod terrainLod;
+		TerrainRenderer terrainRenderer;
+		bool bTerrainLod = true;
+		int broadPhaseLevel = 1;    // 4 times fewer triangles than the mesh
+
+		bool bSimReady = false;     // octree built, the lander can fly
 
 		ofLight light;
 		Box boundingBox;
@@ -70,18 +91,9 @@ class ofApp : public ofBaseApp{
 		bool bTerrainSelected = true;
 		bool bdrawOctree = false;
 		bool bdrawLeaf = false;
-		bool b_selectedNode = false;
 		//ofVec3f selectedPoint;
-		ofVec3f selectedVertex;
-
-		// some bool for controls
-		// two bool for checking collision
-		bool groundTouched = false;
-		bool completeStopped = false;
-		bool hanging = false;
 
 		const float selectionRange = 4.0;
-		Octree octree;
 		TreeNode selectedNode;
 
 		// 8 levels for moon-houdini
@@ -89,32 +101,10 @@ class ofApp : public ofBaseApp{
 		int levels = 8; 
 		int drawlevels = 8;
 
-		// Ship core
-		ParticleSystem* shipsys = nullptr;
-		Particle *core = nullptr;
-		
-		// emitter
-		ParticleEmitter* emitter;
-		bool startEmitter = false;
-		//ofVec3f landerCenter; // emitter position
-
-		// Forces
-		float thrusterMag = 5.0f; // by default
-		float autoPilotMag = 2.0f;
-		float materialRestitution = 0.4f; // by default
-		float moonGravityMag = 1.62f;
-		ofVec3f zeroVec = ofVec3f(0,0,0);
-		ofVec3f turbMin = ofVec3f(-0.7, -0.7, -0.7);
-		ofVec3f turbMax = ofVec3f(0.7, 0.7, 0.7);
-		ofVec3f gravityF = ofVec3f(0, -moonGravityMag, 0);
-		ofVec3f OppositeGravityF = ofVec3f(0, moonGravityMag, 0);
-		TurbulenceForce *turbulanceForce = nullptr;
-		Thruster *thrusterForce = nullptr;
-		GravityForce *moonGravity = nullptr;
-		ImpulseForce *impulseForce = nullptr;
-		GravityForce *supportGravityForce = nullptr; // the support force of the ground
-		Thruster *hangingForce = nullptr;
-		Thruster *autoPilotForce = nullptr;
+		// the game itself, ofApp only feeds it input and draws it.  Every
+		// step of a game is recorded to bin/data/flight-<time>.flr, see
+		// tools/flightrec for reading it back.
+		LanderSim sim;
 
 		// Little Menu
 		bool isGameStart = false;
@@ -122,17 +112,26 @@ class ofApp : public ofBaseApp{
 		string fontPath = "font/SpicyRice-Regular.ttf";
 
 		// textures	
+		ofPixels particlePixels;
 		ofTexture  particleTex;
 
 		//shader 
-		ofVbo vbo;
+		ParticleStreamBuffer particleBuffer;
 		ofShader shader;
 		float particleRadius = 3.2;
 
 		// sound
 		ofSoundPlayer thrusterSound;
 
+		// screenshots (s) and frame sequences (S), read back and written
+		// off the render thread
+		FrameCapture frameCapture;
+
 		// Light 
 		ofLight pointLight;
-		
+
+		// startup jobs, see setup().  Declared last so it is destroyed
+		// first: its destructor waits for jobs still writing the members
+		// above.
+		AsyncLoader loader;
 };
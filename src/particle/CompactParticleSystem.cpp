@@ -0,0 +1,204 @@
+#include "CompactParticleSystem.h"
+#include "../utils/ThreadPool.h"
+#include "../utils/Profiler.h"
+#include "../render/SphereImpostors.h"
+
+CompactParticleSystem::CompactParticleSystem() {
+}
+
+CompactParticleSystem::~CompactParticleSystem() {
+	if (budget) budget->untrack(this);
+}
+
+// a negative lifespan never expires.  A finite one too long for 16 bit
+// ticks is cut to the longest there is, it must not turn into 0xFFFF.
+//
+uint16_t CompactParticleSystem::quantizeLife(float sec) {
+	if (sec < 0) return NeverExpires;
+	float ticks = sec / ageQuantum + 0.5f;
+	if (ticks >= NeverExpires) {
+		if (!lifeClamped) {
+			cout << "CompactParticleSystem: lifespan " << sec << " sec cut to "
+				<< (NeverExpires - 1) * ageQuantum << " sec, raise ageQuantum for longer ones" << endl;
+			lifeClamped = true;
+		}
+		return NeverExpires - 1;
+	}
+	return (uint16_t)ticks;
+}
+
+// only position, velocity and lifespan are taken from p, every other
+// attribute comes from traits
+//
+void CompactParticleSystem::add(const Particle &p) {
+	add(&p, 1);
+}
+
+void CompactParticleSystem::add(const Particle *p, int n) {
+	size_t first = positions.size();
+	positions.resize(first + n);
+	velocities.resize((first + n) * 3);
+	ages.resize(first + n);
+	lifespans.resize(first + n);
+	for (int i = 0; i < n; i++) {
+		size_t k = first + i;
+		positions[k] = p[i].position;
+		velocities[k * 3] = floatToHalf(p[i].velocity.x);
+		velocities[k * 3 + 1] = floatToHalf(p[i].velocity.y);
+		velocities[k * 3 + 2] = floatToHalf(p[i].velocity.z);
+		ages[k] = 0;
+		lifespans[k] = quantizeLife(p[i].lifespan);
+	}
+}
+
+// one draw call, see SphereImpostors
+//
+void CompactParticleSystem::draw() {
+	SphereImpostors &impostors = SphereImpostors::shared();
+	impostors.clear();
+	impostors.instances.reserve(positions.size());
+	for (const ofVec3f &p : positions) {
+		impostors.add(p, traits.radius, traits.color);
+	}
+	impostors.draw();
+}
+
+void CompactParticleSystem::clear() {
+	positions.clear();
+	velocities.clear();
+	ages.clear();
+	lifespans.clear();
+}
+
+void CompactParticleSystem::update(float dt) {
+	if (budget) {
+		uint64_t start = ofGetElapsedTimeMicros();
+		step(dt);
+		budget->addUpdateCost((double)(ofGetElapsedTimeMicros() - start));
+	}
+	else step(dt);
+}
+
+void CompactParticleSystem::step(float dt) {
+	PROFILE_ZONE("CompactParticleSystem::step");
+
+	// ages advance by whole ticks.  Counting the ticks of the total time
+	// instead of rounding dt keeps every age within one tick of the truth.
+	//
+	int ageTicks = (int)((int64_t)((time + dt) / ageQuantum) - (int64_t)(time / ageQuantum));
+	time += dt;
+	steps++;
+
+	removeExpired();
+	int count = size();
+	if (count == 0) return;
+
+	// user forces which are not thread safe keep the update serial
+	//
+	bool parallel = threaded && count >= parallelThreshold;
+	for (int i = 0; i < forces.size(); i++) {
+		if (!forces[i]->isThreadSafe()) parallel = false;
+	}
+
+	auto kernel = [this, dt, ageTicks](int begin, int end) {
+		RandomStream rng = RandomStream::forChunk(seed, steps, begin / chunkSize);
+		stepChunk(begin, end, dt, ageTicks, rng);
+	};
+	if (parallel) {
+		ThreadPool::shared().parallelFor(count, chunkSize, kernel);
+	}
+	else {
+		for (int begin = 0; begin < count; begin += chunkSize)
+			kernel(begin, std::min(begin + chunkSize, count));
+	}
+
+	for (int i = 0; i < forces.size(); i++) {
+		if (forces[i]->applyOnce)
+			forces[i]->applied = true;
+	}
+}
+
+// decode 64 particles at a time, apply forces, integrate, encode back
+//
+void CompactParticleSystem::stepChunk(int begin, int end, float dt, int ageTicks, RandomStream &rng) {
+	const int blockSize = 64;
+	Particle block[blockSize];
+	for (int i = 0; i < blockSize; i++) {
+		block[i].mass = traits.mass;
+		block[i].damping = traits.damping;
+		block[i].radius = traits.radius;
+	}
+
+	for (int b = begin; b < end; b += blockSize) {
+		int n = std::min(blockSize, end - b);
+		for (int i = 0; i < n; i++) {
+			int k = b + i;
+			block[i].position = positions[k];
+			block[i].velocity.set(halfToFloat(velocities[k * 3]), halfToFloat(velocities[k * 3 + 1]),
+				halfToFloat(velocities[k * 3 + 2]));
+			block[i].forces.set(0, 0, 0);
+		}
+
+		// a bounded force skips the whole block unless its region
+		// reaches the box around it
+		//
+		ofVec3f lo = block[0].position;
+		ofVec3f hi = lo;
+		for (int f = 0; f < forces.size(); f++) {
+			if (forces[f]->bounded) {
+				for (int i = 1; i < n; i++) {
+					const ofVec3f &p = block[i].position;
+					lo.x = std::min(lo.x, p.x); hi.x = std::max(hi.x, p.x);
+					lo.y = std::min(lo.y, p.y); hi.y = std::max(hi.y, p.y);
+					lo.z = std::min(lo.z, p.z); hi.z = std::max(hi.z, p.z);
+				}
+				break;
+			}
+		}
+
+		for (int f = 0; f < forces.size(); f++) {
+			ParticleForce *force = forces[f];
+			if (force->applied) continue;
+			if (!force->bounded)
+				force->updateForces(block, n, rng);
+			else if (force->touches(lo, hi))
+				force->updateForcesInRegion(block, n, rng);
+		}
+
+		for (int i = 0; i < n; i++) {
+			int k = b + i;
+			block[i].integrate(dt);
+			positions[k] = block[i].position;
+			velocities[k * 3] = floatToHalf(block[i].velocity.x);
+			velocities[k * 3 + 1] = floatToHalf(block[i].velocity.y);
+			velocities[k * 3 + 2] = floatToHalf(block[i].velocity.z);
+			int a = ages[k] + ageTicks;
+			ages[k] = (uint16_t)std::min(a, 0xFFFF);
+		}
+	}
+}
+
+// drop particles older than their lifespan, keeping the order of the rest
+//
+void CompactParticleSystem::removeExpired() {
+	int n = size();
+	int alive = 0;
+	for (int i = 0; i < n; i++) {
+		if (lifespans[i] != NeverExpires && ages[i] > lifespans[i]) continue;
+		if (alive != i) {
+			positions[alive] = positions[i];
+			velocities[alive * 3] = velocities[i * 3];
+			velocities[alive * 3 + 1] = velocities[i * 3 + 1];
+			velocities[alive * 3 + 2] = velocities[i * 3 + 2];
+			ages[alive] = ages[i];
+			lifespans[alive] = lifespans[i];
+		}
+		alive++;
+	}
+	if (alive != n) {
+		positions.resize(alive);
+		velocities.resize(alive * 3);
+		ages.resize(alive);
+		lifespans.resize(alive);
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ParticleSystem.h"
+#include "../utils/Half.h"
+
+//  Attributes every particle of a compact system shares.  For the exhaust
+//  these come straight from the emitter settings.
+//
+struct ParticleTraits {
+	float mass = 1;
+	float damping = .99;
+	float radius = .1;
+	ofColor color = ofColor::aquamarine;
+};
+
+//  Memory lean particle system for large numbers of look-alike particles.
+//
+//  Mass, damping, radius and color live once in "traits" instead of in
+//  every particle, and the per particle state is stored column by column
+//  in reduced precision:
+//
+//      position    3 x float    12 bytes  (kept full, it is what we draw)
+//      velocity    3 x half      6 bytes
+//      age         uint16        2 bytes  (units of ageQuantum)
+//      lifespan    uint16        2 bytes  (0xFFFF = never expires)
+//
+//  22 bytes against the 70+ of a Particle.  positions is contiguous, so it
+//  can be uploaded for drawing as is.
+//
+//  Forces are the same ParticleForce objects as for ParticleSystem.  The
+//  update decodes a small block of particles into full Particles on the
+//  stack, runs the forces and the integrator on it and encodes it back, so
+//  the full size state never leaves the cache.
+//
+class CompactParticleSystem {
+public:
+	CompactParticleSystem();
+	~CompactParticleSystem();
+
+	static const uint16_t NeverExpires = 0xFFFF;
+
+	void add(const Particle &p);
+	void add(const Particle *p, int n);
+	void addForce(ParticleForce *f) { forces.push_back(f); }
+	void update(float dt);
+	void removeExpired();
+	void clear();
+	void draw();
+	void setThreaded(bool b) { threaded = b; }
+	void setSeed(uint64_t s) { seed = s; }
+
+	int size() const { return (int)positions.size(); }
+	float age(int i) const { return ages[i] * ageQuantum; }
+	ofVec3f velocity(int i) const {
+		return ofVec3f(halfToFloat(velocities[i * 3]), halfToFloat(velocities[i * 3 + 1]), halfToFloat(velocities[i * 3 + 2]));
+	}
+	static int bytesPerParticle() { return sizeof(ofVec3f) + 3 * sizeof(uint16_t) + 2 * sizeof(uint16_t); }
+
+	ParticleTraits traits;
+	float ageQuantum = 1.0 / 1024;   // sec per age tick, max lifespan ~64 sec
+
+	vector<ofVec3f> positions;
+	vector<uint16_t> velocities;     // 3 halfs per particle
+	vector<uint16_t> ages;
+	vector<uint16_t> lifespans;
+	vector<ParticleForce *> forces;
+
+	double time = 0;
+	unsigned long steps = 0;
+	uint64_t seed = 1;
+	bool threaded = false;
+	int parallelThreshold = 4096;
+	int chunkSize = 1024;
+	ParticleBudget *budget = nullptr;
+
+private:
+	void step(float dt);
+	void stepChunk(int begin, int end, float dt, int ageTicks, RandomStream &rng);
+	uint16_t quantizeLife(float sec);
+
+	bool lifeClamped = false;        // warned about a lifespan past the last tick
+};
@@ -0,0 +1,157 @@
+
+#include "IntegratorHarness.h"
+#include "StaticParticleSystem.h"
+
+typedef StaticParticleSystem<GravityForce, Thruster, ImpulseForce, DragForce> HarnessSystem;
+
+static const float harnessGravity = 1.62f;    // moon
+static const float harnessThrust = 3.0f;
+static const float harnessDrag = 0.1f;        // 1/s
+static const float harnessRestitution = 0.4f;
+static const int thrustOn = 2, thrustOff = 5; // sec
+static const int referenceStepsPerSec = 3840;
+
+struct HarnessSample {
+	ofVec3f position;
+	float energy;            // per unit mass
+	bool touched;            // ground contact happened by now
+};
+
+static int stagesOf(Integrator i) {
+	return (i == RK4) ? 4 : (i == VelocityVerlet) ? 2 : 1;
+}
+
+// run the scenario, sampling the state at the end of every second
+//
+static void simulate(Integrator integrator, int stepsPerSec, float duration, vector<HarnessSample> &out) {
+	HarnessSystem sys;
+	sys.setIntegrator(integrator);
+	sys.force<0>().set(ofVec3f(0, -harnessGravity, 0));
+	sys.force<3>().set(harnessDrag);
+
+	Particle lander;
+	lander.position.set(0, 30, 0);
+	lander.velocity.set(2, 0, 0);
+	lander.lifespan = -1;
+	sys.add(lander);
+
+	float dt = 1.0f / stepsPerSec;
+	int steps = (int)(duration * stepsPerSec);
+	bool touched = false;
+	out.clear();
+	for (int i = 0; i < steps; i++) {
+		if (i >= thrustOn * stepsPerSec && i < thrustOff * stepsPerSec) sys.force<1>().set(ofVec3f(0, 1, 0), harnessThrust);
+		else sys.force<1>().set(ofVec3f(0, 0, 0), 0);
+
+		sys.update(dt);
+
+		// same response as the game: an impulse that reverses the normal
+		// velocity within the next step
+		//
+		Particle &p = sys.particles[0];
+		if (p.position.y < 0 && p.velocity.y < 0) {
+			sys.force<2>().set(glm::vec3(p.velocity * (-1.0f / dt)), glm::vec3(0, 1, 0), harnessRestitution);
+			touched = true;
+		}
+
+		if ((i + 1) % stepsPerSec == 0) {
+			HarnessSample s;
+			s.position = p.position;
+			s.energy = 0.5f * p.velocity.lengthSquared() + harnessGravity * p.position.y;
+			s.touched = touched;
+			out.push_back(s);
+		}
+	}
+}
+
+// where the lander is t sec into the flight, ignoring the ground.  Gravity
+// and the thruster are constant between the switches, so each piece of
+// the flight has the closed form
+//
+//     v(t) = w + (v0 - w) e^-kt,  x(t) = x0 + w t + (v0 - w) (1 - e^-kt) / k
+//
+// with k the drag and w = a / k the terminal velocity.  Worked out in
+// double, a reference run in float drifts by mm over its many steps.
+//
+static ofVec3f exactFlight(double t) {
+	const double k = harnessDrag;
+	const double ends[] = { thrustOn, thrustOff, t };
+	double x[3] = { 0, 30, 0 };
+	double v[3] = { 2, 0, 0 };
+	double start = 0;
+	for (int s = 0; s < 3 && start < t; s++) {
+		double h = std::min(ends[s], t) - start;
+		double a[3] = { 0, -harnessGravity + (s == 1 ? harnessThrust : 0), 0 };
+		double e = exp(-k * h);
+		for (int c = 0; c < 3; c++) {
+			double w = a[c] / k;
+			x[c] += w * h + (v[c] - w) * (1 - e) / k;
+			v[c] = w + (v[c] - w) * e;
+		}
+		start += h;
+	}
+	return ofVec3f(x[0], x[1], x[2]);
+}
+
+vector<IntegratorResult> runIntegratorHarness(float duration) {
+	vector<HarnessSample> reference, run;
+	simulate(RK4, referenceStepsPerSec, duration, reference);
+
+	static const int rates[] = { 15, 30, 60, 120, 240 };
+	static const Integrator integrators[] = { SymplecticEuler, VelocityVerlet, RK4 };
+
+	vector<IntegratorResult> results;
+	for (Integrator integrator : integrators) {
+		for (int rate : rates) {
+			simulate(integrator, rate, duration, run);
+
+			IntegratorResult r;
+			r.integrator = integrator;
+			r.stepsPerSec = rate;
+			r.evalsPerSec = rate * stagesOf(integrator);
+			r.flightError = 0;
+			r.maxError = 0;
+			r.energyError = 0;
+			for (int i = 0; i < run.size() && i < reference.size(); i++) {
+				ofVec3f exact = exactFlight(i + 1);
+				if (!run[i].touched && exact.y > 0)
+					r.flightError = std::max(r.flightError, run[i].position.distance(exact));
+				r.maxError = std::max(r.maxError, run[i].position.distance(reference[i].position));
+				r.energyError = std::max(r.energyError, fabsf(run[i].energy - reference[i].energy));
+			}
+			results.push_back(r);
+		}
+	}
+	return results;
+}
+
+void printIntegratorReport(const vector<IntegratorResult> &results, float tolerance) {
+	char line[160];
+	cout << "integrator          steps/s  evals/s   flight err(m)  max err(m)  energy err(J/kg)" << endl;
+	for (const IntegratorResult &r : results) {
+		snprintf(line, sizeof(line), "%-18s %8d %8d %15.6f %11.4f %17.4f",
+			integratorName(r.integrator), r.stepsPerSec, r.evalsPerSec, r.flightError, r.maxError, r.energyError);
+		cout << line << endl;
+	}
+	cout << "(flight errors of a few 1e-5 m are the float round off of the run itself," << endl;
+	cout << " after the first contact the error is mostly in which step the contact is found)" << endl;
+
+	// cheapest setting of each integrator within tolerance in flight
+	//
+	for (int k = SymplecticEuler; k <= RK4; k++) {
+		const IntegratorResult *best = NULL;
+		for (const IntegratorResult &r : results) {
+			if (r.integrator != k || r.flightError > tolerance) continue;
+			if (!best || r.evalsPerSec < best->evalsPerSec) best = &r;
+		}
+		if (best) {
+			snprintf(line, sizeof(line), "%s: %d steps/s (%d force evaluations/s) for %.0fcm in flight",
+				integratorName((Integrator)k), best->stepsPerSec, best->evalsPerSec, tolerance * 100);
+		}
+		else {
+			snprintf(line, sizeof(line), "%s: no tested rate within %.0fcm in flight",
+				integratorName((Integrator)k), tolerance * 100);
+		}
+		cout << line << endl;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ParticleSystem.h"
+
+//  Compares the integrators of ParticleSystem on the lander scenario.
+//
+//  The lander starts 30m up drifting sideways under a light linear drag,
+//  burns its main thruster between 2 and 5 sec, falls and bounces on the
+//  ground through an ImpulseForce exactly like in the game.  Every
+//  integrator is run at a range of step rates and compared once per
+//  simulated second: in flight against the closed form solution, after
+//  the first contact against RK4 at a very small step.  Without the drag
+//  the flight is at constant acceleration piecewise, which Verlet and RK4
+//  both integrate exactly.  Cost is counted in force evaluations, which is
+//  what a step of a real system spends its time on.
+//
+struct IntegratorResult {
+	Integrator integrator;
+	int stepsPerSec;
+	int evalsPerSec;        // force evaluations per simulated second
+	float flightError;      // m, max position error before the first contact
+	float maxError;         // m, max position error over the whole run
+	float energyError;      // J/kg, max error of the mechanical energy
+};
+
+vector<IntegratorResult> runIntegratorHarness(float duration = 16);
+
+// print the results as a table, and for each integrator the cheapest step
+// rate that stays within tolerance (m) in flight
+//
+void printIntegratorReport(const vector<IntegratorResult> &results, float tolerance = 0.01f);
@@ -11,6 +11,9 @@ Particle::Particle() {
 	forces.set(0, 0, 0);
 	lifespan = 5;
 	birthtime = 0;
+	handle = -1;
+	asleep = false;
+	stillSteps = 0;
 	radius = .1;
 	damping = .99;
 	mass = 1;
@@ -24,16 +27,9 @@ void Particle::draw() {
 }
 
 
-void Particle::integrate() {
-
-	// check for 0 framerate to avoid divide errors
-	//
-	float framerate = ofGetFrameRate();
-	if (framerate < 1.0) return;
-
-	// interval for this step
-	//
-	float dt = 1.0 / framerate;
+//  advance the particle by one fixed step of dt seconds
+//
+void Particle::integrate(float dt) {
 
 	// update acceleration with accumulated paritcles forces
 	// remember :  (f = ma) OR (a = 1/m * f)
@@ -63,10 +59,18 @@ void Particle::reset() {
 
 }
 
-//  return age in seconds
+// stop integrating the particle where it is
+//
+void Particle::sleep() {
+	asleep = true;
+	velocity.set(0, 0, 0);
+	forces.set(0, 0, 0);
+}
+
+//  return age in seconds, "now" is the current simulation time
 //
-float Particle::age() {
-	return (ofGetElapsedTimeMillis() - birthtime)/1000.0;
+float Particle::age(double now) const {
+	return (float)(now - birthtime);
 }
 
 
@@ -16,11 +16,16 @@ public:
 	float   mass;
 	float   lifespan;
 	float   radius;
-	float   birthtime;
-	void    integrate();
+	double  birthtime;    // sec (simulation time)
+	int     handle;       // stable id in its ParticleSystem, -1 if none
+	bool    asleep;       // not integrated until woken, see ParticleSystem::setSleep()
+	int     stillSteps;   // steps in a row spent under the sleep thresholds
+	void    integrate(float dt);
 	void    draw();
-	float   age();        // sec
+	float   age(double now) const;  // sec
 	void    reset();
+	void    sleep();
+	void    wake() { asleep = false; stillSteps = 0; }
 	ofColor color;
 };
 
@@ -0,0 +1,79 @@
+#include "ParticleBudget.h"
+#include "ParticleSystem.h"
+#include "CompactParticleSystem.h"
+
+ParticleBudget & ParticleBudget::shared() {
+	static ParticleBudget budget;
+	return budget;
+}
+
+void ParticleBudget::track(ParticleSystem *sys) {
+	if (std::find(systems.begin(), systems.end(), sys) != systems.end()) return;
+	systems.push_back(sys);
+	sys->budget = this;
+}
+
+void ParticleBudget::untrack(ParticleSystem *sys) {
+	systems.erase(std::remove(systems.begin(), systems.end(), sys), systems.end());
+	if (sys->budget == this) sys->budget = nullptr;
+}
+
+void ParticleBudget::track(CompactParticleSystem *sys) {
+	if (std::find(compactSystems.begin(), compactSystems.end(), sys) != compactSystems.end()) return;
+	compactSystems.push_back(sys);
+	sys->budget = this;
+}
+
+void ParticleBudget::untrack(CompactParticleSystem *sys) {
+	compactSystems.erase(std::remove(compactSystems.begin(), compactSystems.end(), sys), compactSystems.end());
+	if (sys->budget == this) sys->budget = nullptr;
+}
+
+void ParticleBudget::endFrame() {
+	liveParticles = 0;
+	for (int i = 0; i < systems.size(); i++) {
+		liveParticles += (int)systems[i]->particles.size();
+	}
+	for (int i = 0; i < compactSystems.size(); i++) {
+		liveParticles += compactSystems[i]->size();
+	}
+
+	// smooth the measured time a little so one slow frame does not
+	// throttle emission on its own
+	//
+	frameMs = frameMs * 0.8f + (float)(frameMicros / 1000.0) * 0.2f;
+
+	// how far over budget we are, by time or by memory
+	//
+	float load = frameMs / frameBudgetMs;
+	float fill = (float)liveParticles / particleCap;
+	float pressure = std::max(load, fill);
+
+	if (pressure > 1.0f) {
+		scale = std::max(minScale, scale / pressure);
+	}
+	else if (scale < 1.0f) {
+		scale = std::min(1.0f, scale * recoverRate);
+	}
+
+	// report when throttling starts, stops or moves by a tenth
+	//
+	int band = (int)(scale * 10 + 0.5f);
+	if (band != reportedBand) {
+		if (band >= 10) ofLogNotice("ParticleBudget") << "back under budget, emission restored";
+		else ofLogNotice("ParticleBudget") << getReport();
+		reportedBand = band;
+	}
+}
+
+float ParticleBudget::emissionScale(float priority) const {
+	priority = ofClamp(priority, 0.0f, 1.0f);
+	return 1.0f - (1.0f - scale) * (1.0f - priority);
+}
+
+string ParticleBudget::getReport() const {
+	string str = "particles: " + ofToString(liveParticles) + "/" + ofToString(particleCap) +
+		"  update: " + ofToString(frameMs, 2) + "/" + ofToString(frameBudgetMs, 2) + " ms";
+	if (isThrottling()) str += "  throttled to " + ofToString((int)(scale * 100)) + "%";
+	return str;
+}
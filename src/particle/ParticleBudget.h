@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ofMain.h"
+
+class ParticleSystem;
+class CompactParticleSystem;
+
+//  Global particle budget.
+//
+//  Tracked systems report the time each update() takes; once per frame
+//  endFrame() compares the total against the configured frame time and the
+//  live particle count against the particle cap.  When either is exceeded
+//  the budget lowers a global scale factor, and emitters feeding tracked
+//  systems spawn fewer (or shorter lived) particles according to their
+//  priority.  The scale recovers slowly once the load drops again.  Every
+//  change of throttling state is logged, and getReport() gives a one line
+//  summary for on-screen display.
+//
+class ParticleBudget {
+public:
+	static ParticleBudget & shared();
+
+	void setFrameBudget(float ms) { frameBudgetMs = ms; }
+	void setParticleCap(int n) { particleCap = n; }
+
+	void track(ParticleSystem *sys);
+	void untrack(ParticleSystem *sys);
+	void track(CompactParticleSystem *sys);
+	void untrack(CompactParticleSystem *sys);
+
+	void beginFrame() { frameMicros = 0; }
+	void addUpdateCost(double micros) { frameMicros += micros; }
+	void endFrame();
+
+	// priority in [0, 1]:  0 is throttled fully, 1 is never throttled
+	float emissionScale(float priority) const;
+
+	bool isThrottling() const { return scale < 1.0f; }
+	int getLiveParticles() const { return liveParticles; }
+	float getFrameMs() const { return frameMs; }
+	string getReport() const;
+
+	float frameBudgetMs = 2.0f;     // particle update time per frame
+	int particleCap = 500000;       // live particles over all systems
+	float minScale = 0.05f;
+	float recoverRate = 1.02f;      // per frame, once back under budget
+
+private:
+	vector<ParticleSystem *> systems;
+	vector<CompactParticleSystem *> compactSystems;
+	double frameMicros = 0;
+	float frameMs = 0;              // smoothed update time
+	int liveParticles = 0;
+	float scale = 1.0f;
+	int reportedBand = 10;          // last logged scale, in tenths
+};
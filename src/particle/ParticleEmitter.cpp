@@ -20,6 +20,20 @@ ParticleEmitter::ParticleEmitter(ParticleSystem *s) {
 	init();
 }
 
+// particles go to a compact system, no ParticleSystem is made at all
+//
+ParticleEmitter::ParticleEmitter(CompactParticleSystem *c) {
+	if (c == NULL)
+	{
+		cout << "fatal error: null particle system passed to ParticleEmitter()" << endl;
+		ofExit();
+	}
+	sys = NULL;
+	createdSys = false;
+	init();
+	compactSys = c;
+}
+
 ParticleEmitter::~ParticleEmitter() {
 
 	// deallocate particle system if emitter created one internally
@@ -46,6 +60,11 @@ void ParticleEmitter::init() {
 	damping = .99;
 	particleColor = ofColor::red;
 	position = ofVec3f(0, 0, 0);
+	priority = 0.5;
+	throttleLifetime = false;
+	spawnCarry = 0;
+	lifeScale = 1;
+	compactSys = nullptr;
 }
 
 
@@ -67,31 +86,41 @@ void ParticleEmitter::draw() {
 			break;
 		}
 	}
-	sys->draw();  
+	if (compactSys) compactSys->draw();
+	else sys->draw();  
 }
 void ParticleEmitter::start() {
 	if (started) return;
 	started = true;
 	oneShot = true;
-	lastSpawned = ofGetElapsedTimeMillis();
+	lastSpawned = simTime();
 }
 
 void ParticleEmitter::stop() {
 	started = false;
 	fired = false;
 }
-void ParticleEmitter::update() {
+void ParticleEmitter::update(float dt) {
+
+	double time = simTime();
 
-	float time = ofGetElapsedTimeMillis();
+	// scale the groups down if the particle budget asks for it
+	//
+	float countScale = 1;
+	lifeScale = 1;
+	ParticleBudget *budget = getBudget();
+	if (budget && budget->isThrottling()) {
+		float s = budget->emissionScale(priority);
+		if (throttleLifetime) lifeScale = s;
+		else countScale = s;
+	}
 
 	if (oneShot && started) {
 		if (!fired) {
 
 			// spawn a new particle(s)
 			//
-			for (int i = 0; i < groupSize; i++) {
-				spawn(time);
-			}
+			spawnGroup(scaledGroupSize(countScale), time);
 
 			lastSpawned = time;
 		}
@@ -100,71 +129,162 @@ void ParticleEmitter::update() {
 		stop();
 	}
 
-	else if (((time - lastSpawned) > (1000.0 / rate)) && started) {
+	else if (((time - lastSpawned) > (1.0 / rate)) && started) {
 
 		// spawn a new particle(s)
 		//
-		for (int i= 0; i < groupSize; i++)
-			spawn(time);
-	
+		spawnGroup(scaledGroupSize(countScale), time);
+
 		lastSpawned = time;
 	}
 
-	sys->update();
+	if (compactSys) compactSys->update(dt);
+	else sys->update(dt);
+}
+
+// size of the group fired now.  Only fired groups take from the
+// fractional part carried over, so a scale of .5 on a group of 1 spawns
+// every other group however many updates there are in between.
+//
+int ParticleEmitter::scaledGroupSize(float scale) {
+	if (scale >= 1) return groupSize;
+	spawnCarry += groupSize * scale;
+	int n = (int)spawnCarry;
+	spawnCarry -= n;
+	return n;
 }
 
 // spawn a single particle.  time is current time of birth
 //
-void ParticleEmitter::spawn(float time) {
+void ParticleEmitter::spawn(double time) {
+	spawnGroup(1, time);
+}
 
-	Particle particle;
+// spawn n particles at once.  The slots are reserved in the system in one
+// go and written in place, the emitter type is only switched on once per
+// group.
+//
+void ParticleEmitter::spawnGroup(int n, double time) {
+	if (n <= 0) return;
+
+	// attributes shared by all emitter types, every particle of the group
+	// is constructed as a copy of this
+	//
+	Particle proto;
+	proto.lifespan = lifespan * lifeScale;
+	proto.birthtime = time;
+	proto.radius = particleRadius;
+	proto.mass = mass;
+	proto.damping = damping;
+	proto.color = particleColor;
+
+	// a compact system keeps only position, velocity and lifespan, so
+	// stage the group in full Particles and let it pack them
+	//
+	Particle *p;
+	if (compactSys) {
+		spawnScratch.assign(n, proto);
+		p = &spawnScratch[0];
+		compactSys->traits.mass = mass;
+		compactSys->traits.damping = damping;
+		compactSys->traits.radius = particleRadius;
+		compactSys->traits.color = particleColor;
+	}
+	else {
+		p = sys->addBlock(n, proto);
+	}
+	if (randomLife) {
+		float life[256];
+		for (int begin = 0; begin < n; begin += 256) {
+			int count = std::min(256, n - begin);
+			rng.fill(life, count, lifeMinMax.x, lifeMinMax.y);
+			for (int i = 0; i < count; i++) p[begin + i].lifespan = life[i] * lifeScale;
+		}
+	}
 
 	// set initial velocity and position
 	// based on emitter type
 	//
 	switch (type) {
+	case DirectionalEmitter:
+		spawnDirectional(p, n);
+		break;
 	case RadialEmitter:
-	  {
-		ofVec3f dir = ofVec3f(ofRandom(-1, 1), ofRandom(-1, 1), ofRandom(-1, 1));
-		float speed = velocity.length();
-		particle.velocity = dir.getNormalized() * speed;
-		particle.position.set(position);
-	  }
-	break;
-	case SphereEmitter:
+		spawnRadial(p, n);
 		break;
-	case DirectionalEmitter:
-		particle.velocity = velocity;
-		particle.position.set(position);
+	case SphereEmitter:
+		spawnSphere(p, n);
 		break;
-	case DiscEmitter: 
-		float rad = ofRandom(0,2*PI);
-		ofVec3f pos = ofVec3f(cos(rad), ofRandom(-2,-1), sin(rad)) * 0.20f;
-		float speed = velocity.length() * ofRandom(0.5,1);
-		particle.velocity = ofVec3f(0,-1, 0) * speed;
-		particle.position.set(position + pos);
-		
-		// ofVec3f dir = ofVec3f(ofRandom(-1,1), ofRandom(-.2,.2), ofRandom(-1,1));
-		// particle.position.set(position + (dir.normalized() * radius));
-		// particle.velocity = velocity;
-		
-		
+	case DiscEmitter:
+		spawnDisc(p, n);
 		break;
 	}
 
-	// other particle attributes
-	//
-	if (randomLife) {
-		particle.lifespan = ofRandom(lifeMinMax.x, lifeMinMax.y);
+	if (compactSys) compactSys->add(p, n);
+}
+
+void ParticleEmitter::spawnDirectional(Particle *p, int n) {
+	for (int i = 0; i < n; i++) {
+		p[i].position = position;
+		p[i].velocity = velocity;
+	}
+}
+
+// random direction, speed of the emitter velocity
+//
+void ParticleEmitter::spawnRadial(Particle *p, int n) {
+	float speed = velocity.length();
+	float rx[256], ry[256], rz[256];
+	for (int begin = 0; begin < n; begin += 256) {
+		int count = std::min(256, n - begin);
+		rng.fill(rx, count, -1, 1);
+		rng.fill(ry, count, -1, 1);
+		rng.fill(rz, count, -1, 1);
+		for (int i = 0; i < count; i++) {
+			ofVec3f dir = ofVec3f(rx[i], ry[i], rz[i]);
+			Particle &q = p[begin + i];
+			q.position = position;
+			q.velocity = dir.getNormalized() * speed;
+		}
+	}
+}
+
+// uniformly distributed on the surface of a sphere of the emitter radius,
+// moving straight out at the speed of the emitter velocity
+//
+void ParticleEmitter::spawnSphere(Particle *p, int n) {
+	float speed = velocity.length();
+	float rz[256], rphi[256];
+	for (int begin = 0; begin < n; begin += 256) {
+		int count = std::min(256, n - begin);
+		rng.fill(rz, count, -1, 1);
+		rng.fill(rphi, count, 0, 2 * PI);
+		for (int i = 0; i < count; i++) {
+			float z = rz[i];
+			float r = sqrtf(std::max(0.0f, 1 - z * z));
+			ofVec3f dir = ofVec3f(r * cosf(rphi[i]), r * sinf(rphi[i]), z);
+			Particle &q = p[begin + i];
+			q.position = position + dir * radius;
+			q.velocity = dir * speed;
+		}
+	}
+}
+
+// thruster flame: a ring just below the emitter, blown downward
+//
+void ParticleEmitter::spawnDisc(Particle *p, int n) {
+	float speed = velocity.length();
+	float rad[256], ry[256], rs[256];
+	for (int begin = 0; begin < n; begin += 256) {
+		int count = std::min(256, n - begin);
+		rng.fill(rad, count, 0, 2 * PI);
+		rng.fill(ry, count, -2, -1);
+		rng.fill(rs, count, 0.5, 1);
+		for (int i = 0; i < count; i++) {
+			Particle &q = p[begin + i];
+			ofVec3f pos = ofVec3f(cosf(rad[i]), ry[i], sinf(rad[i])) * 0.20f;
+			q.position = position + pos;
+			q.velocity = ofVec3f(0, -speed * rs[i], 0);
+		}
 	}
-	else particle.lifespan = lifespan;
-	particle.birthtime = time;
-	particle.radius = particleRadius;
-	particle.mass = mass;
-	particle.damping = damping;
-	particle.color = particleColor;
-
-	// add to system
-	//
-	sys->add(particle);
 }
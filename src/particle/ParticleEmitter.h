@@ -3,6 +3,7 @@
 
 #include "TransformObject.h"
 #include "ParticleSystem.h"
+#include "CompactParticleSystem.h"
 
 typedef enum { DirectionalEmitter, RadialEmitter, SphereEmitter, DiscEmitter } EmitterType;
 
@@ -13,6 +14,7 @@ class ParticleEmitter : public TransformObject {
 public:
 	ParticleEmitter();
 	ParticleEmitter(ParticleSystem *s);
+	ParticleEmitter(CompactParticleSystem *c);
 	~ParticleEmitter();
 	void init();
 	void draw();
@@ -29,9 +31,13 @@ public:
 	void setLifespanRange(const ofVec2f &r) { lifeMinMax = r; }
 	void setMass(float m) { mass = m; }
 	void setDamping(float d) { damping = d; }
-	void update();
-	void spawn(float time);
+	void setSeed(uint64_t s) { rng.setSeed(s); }
+	void setPriority(float p) { priority = p; }
+	void update(float dt);
+	void spawn(double time);
+	void spawnGroup(int n, double time);
 	ParticleSystem *sys;
+	CompactParticleSystem *compactSys;   // if set, particles go here and sys is NULL
 	float rate;         // per sec
 	bool oneShot;
 	bool fired;
@@ -42,7 +48,7 @@ public:
 	float mass;
 	float damping;
 	bool started;
-	float lastSpawned;  // ms
+	double lastSpawned; // sec (simulation time of the owning system)
 	float particleRadius;
 	ofColor particleColor;
 	float radius;
@@ -50,4 +56,27 @@ public:
 	int groupSize;      // number of particles to spawn in a group
 	bool createdSys;
 	EmitterType type;
+
+	// when the system is tracked by a ParticleBudget which is over budget,
+	// emit fewer particles (or shorter lived ones if throttleLifetime),
+	// less so the higher the priority [0, 1]
+	float priority;
+	bool throttleLifetime;
+	float spawnCarry;   // fraction of a particle left over from throttling
+	float lifeScale;
+
+	RandomStream rng;   // own stream so spawning never touches ofRandom()
+
+private:
+	double simTime() const { return compactSys ? compactSys->time : sys->time; }
+	ParticleBudget * getBudget() const { return compactSys ? compactSys->budget : sys->budget; }
+	int scaledGroupSize(float scale);
+	vector<Particle> spawnScratch;       // staging for compactSys
+
+	// one kernel per emitter type, each sets position and velocity of
+	// n freshly added particles
+	void spawnDirectional(Particle *p, int n);
+	void spawnRadial(Particle *p, int n);
+	void spawnSphere(Particle *p, int n);
+	void spawnDisc(Particle *p, int n);
 };
@@ -2,10 +2,66 @@
 // Kevin M.Smith - CS 134 SJSU
 
 #include "ParticleSystem.h"
+#include "../utils/ThreadPool.h"
+#include "../utils/RadixSort.h"
+#include "../utils/Profiler.h"
+#include "../render/SphereImpostors.h"
+#include <new>
 
-void ParticleSystem::add(const Particle &p) {
+// add a copy of p, returns its handle (see get())
+//
+int ParticleSystem::add(const Particle &p) {
 	//cout << &p << endl;
 	particles.push_back(p);
+	int h = newHandle((int)particles.size() - 1);
+	particles.back().handle = h;
+	gridDirty = true;
+	regionListsDirty = true;
+	return h;
+}
+
+// grow the store by n copies of proto and return the first new one, so
+// callers only write what differs per particle, in place, instead of
+// copying them in one by one.  The pointer is only valid until the next add.
+//
+Particle * ParticleSystem::addBlock(int n, const Particle &proto) {
+	size_t first = particles.size();
+	particles.insert(particles.end(), n, proto);
+	for (int i = 0; i < n; i++)
+		particles[first + i].handle = newHandle((int)first + i);
+	gridDirty = true;
+	regionListsDirty = true;
+	return &particles[first];
+}
+
+int ParticleSystem::newHandle(int index) {
+	if (!freeHandles.empty()) {
+		int h = freeHandles.back();
+		freeHandles.pop_back();
+		handleIndex[h] = index;
+		return h;
+	}
+	handleIndex.push_back(index);
+	return (int)handleIndex.size() - 1;
+}
+
+void ParticleSystem::releaseHandle(int h) {
+	if (h < 0) return;
+	handleIndex[h] = -1;
+	freeHandles.push_back(h);
+}
+
+// the particle added under handle h, or NULL if it has been removed.
+// The pointer is only valid until particles are next added or removed.
+//
+Particle * ParticleSystem::get(int h) {
+	int i = indexOf(h);
+	return (i < 0) ? NULL : &particles[i];
+}
+
+int ParticleSystem::indexOf(int h) const {
+	if (h < 0 || h >= handleIndex.size()) return -1;
+	return handleIndex[h];
 }
 
 void ParticleSystem::addForce(ParticleForce *f) {
@@ -13,7 +69,13 @@ void ParticleSystem::addForce(ParticleForce *f) {
 }
 
 void ParticleSystem::remove(int i) {
+	releaseHandle(particles[i].handle);
 	particles.erase(particles.begin() + i);
+	for (int j = i; j < particles.size(); j++) {
+		if (particles[j].handle >= 0) handleIndex[particles[j].handle] = j;
+	}
+	gridDirty = true;
+	regionListsDirty = true;
 }
 
 void ParticleSystem::setLifespan(float l) {
@@ -28,61 +90,523 @@ void ParticleSystem::reset() {
 	}
 }
 
-void ParticleSystem::update() {
+//  advance the system by one fixed step of dt seconds.  The caller owns
+//  the clock (see SimClock), the particles never look at the wall time.
+//
+void ParticleSystem::update(float dt) {
+	if (budget) {
+		uint64_t start = ofGetElapsedTimeMicros();
+		step(dt);
+		budget->addUpdateCost((double)(ofGetElapsedTimeMicros() - start));
+	}
+	else step(dt);
+}
+
+void ParticleSystem::step(float dt) {
+	PROFILE_ZONE("ParticleSystem::step");
+	time += dt;
+	steps++;
+	gridDirty = true;
+
 	// check if empty and just return
 	if (particles.size() == 0 || !enabled)  return;
 
-	vector<Particle>::iterator p = particles.begin();
-	vector<Particle>::iterator tmp;
+	removeExpired();
+	int count = (int)particles.size();
+	if (count == 0) return;
+
+	if (forcesChanged() && sleepSteps > 0) wakeAll();
 
-	// check which particles have exceed their lifespan and delete
-	// from list.  When deleting multiple objects from a vector while
-	// traversing at the same time, we need to use an iterator.
+	if (reorderInterval > 0 && count >= reorderMinParticles && steps % reorderInterval == 0)
+		sortByMorton();
+
+	// forces that are not thread safe go first, on this thread.  They are
+	// applied before the others in serial mode too, so every particle sums
+	// its forces in the same order either way.
 	//
-	while (p != particles.end()) {
-		
-		if (p->lifespan != -1 && p->age() > p->lifespan) {
-			tmp = particles.erase(p);
-			p = tmp;
-		}
-		else p++;
+	RandomStream rng = RandomStream::forChunk(seed, steps, -1);
+	for (int k = 0; k < forces.size(); k++) {
+		if (!forces[k]->applied && !forces[k]->isThreadSafe() && !forces[k]->bounded)
+			forces[k]->updateForces(&particles[0], count, rng);
 	}
 
-	// update forces on all particles first 
+	// forces with a region that are not thread safe only visit the
+	// particles the spatial hash finds in it.  The thread safe ones are
+	// applied per chunk in stepChunk() to the particles on their region
+	// list, see applyBoundedChunk().
 	//
-	for (int i = 0; i < particles.size(); i++) {
-		for (int k = 0; k < forces.size(); k++) {
-			if (!forces[k]->applied)
-				forces[k]->updateForce( &particles[i] );
+	applyBoundedForces(rng);
+	updateRegionLists();
+
+	// remaining forces and integration only touch their own particles,
+	// so they can run on any slice of the array.  Every chunk draws from
+	// its own random stream, which is why serial mode walks the same
+	// chunks as the thread pool does.
+	//
+	auto kernel = [this, dt](int begin, int end) {
+		RandomStream rng = RandomStream::forChunk(seed, steps, begin / chunkSize);
+		stepChunk(begin, end, dt, rng);
+	};
+
+	if (threaded && count >= parallelThreshold) {
+		ThreadPool::shared().parallelFor(count, chunkSize, kernel);
+	}
+	else {
+		for (int begin = 0; begin < count; begin += chunkSize)
+			kernel(begin, std::min(begin + chunkSize, count));
+	}
+
+	if (useRegionLists) {
+		float top = 0;
+		for (int c = 0; c < chunkTopSpeed.size(); c++) top = std::max(top, chunkTopSpeed[c]);
+		regionTravel += sqrtf(top) * dt;
+	}
+
+	markApplied();
+}
+
+const char * integratorName(Integrator i) {
+	switch (i) {
+	case SymplecticEuler: return "symplectic Euler";
+	case VelocityVerlet:  return "velocity Verlet";
+	case RK4:             return "RK4";
+	}
+	return "?";
+}
+
+// apply the thread safe forces to particles [begin, end) and integrate them.
+// Symplectic Euler adds the bounded forces last, the other forces just
+// brought the chunk into cache.
+//
+void ParticleSystem::stepChunk(int begin, int end, float dt, RandomStream &rng) {
+	switch (integrator) {
+	case VelocityVerlet:
+		applyBoundedChunk(begin, end, rng);
+		stepVerlet(begin, end, dt, rng);
+		break;
+	case RK4:
+		applyBoundedChunk(begin, end, rng);
+		stepRK4(begin, end, dt, rng);
+		break;
+	default: {
+		evaluateForces(begin, end, rng);
+		applyBoundedChunk(begin, end, rng);
+		float top = 0;
+		for (int i = begin; i < end; i++) {
+			Particle &p = particles[i];
+			if (p.asleep) {
+				p.forces.set(0, 0, 0);
+				continue;
+			}
+			if (sleepSteps > 0) {
+				ofVec3f accel = p.acceleration + p.forces * (1.0f / p.mass);
+				p.integrate(dt);
+				settle(p, accel);
+			}
+			else p.integrate(dt);
+			top = std::max(top, p.velocity.lengthSquared());
 		}
+		noteTopSpeed(begin, top);
+		break;
+	}
 	}
+}
 
-	// update all forces only applied once to "applied"
-	// so they are not applied again.
-	//
+// The multi stage integrators work through the chunk in small blocks so
+// the state they keep between stages stays on the stack.  On entry the
+// particles already carry the forces of the serial (not thread safe)
+// pass, those are kept as a base and taken as constant over the step.
+// Sleeping particles go through the stages too but are left in place.
+//
+// one shot forces are meant to change the velocity within one step (a
+// contact impulse), spreading them over the stages would move the
+// particle with only part of them.  They are applied up front as a kick,
+// the same change of velocity symplectic Euler gives them.  Leaves the
+// base forces in base[] and on the particles.
+//
+void ParticleSystem::kick(Particle *p, int n, float dt, RandomStream &rng, ofVec3f *base) {
+	int begin = (int)(p - &particles[0]);
+	for (int i = 0; i < n; i++) {
+		base[i] = p[i].forces;
+		p[i].forces.set(0, 0, 0);
+	}
+	evaluateForces(begin, begin + n, rng, OneShotForces);
+	for (int i = 0; i < n; i++) {
+		if (!p[i].asleep) p[i].velocity += p[i].forces * (dt / p[i].mass);
+		p[i].forces = base[i];
+	}
+}
+
+// velocity Verlet: drift with the acceleration at the start of the step,
+// evaluate the forces again at the new position and kick the velocity
+// with the average of both.  The second evaluation sees the velocity the
+// first acceleration predicts, with the old one a force that depends on
+// the velocity (drag) would make the step first order.
+//
+void ParticleSystem::stepVerlet(int begin, int end, float dt, RandomStream &rng) {
+	ofVec3f base[StageBlock], a0[StageBlock], v0[StageBlock];
+	for (int b = begin; b < end; b += StageBlock) {
+		int n = std::min(StageBlock, end - b);
+		Particle *p = &particles[b];
+		kick(p, n, dt, rng, base);
+
+		evaluateForces(b, b + n, rng, SteadyForces);
+		for (int i = 0; i < n; i++) {
+			a0[i] = p[i].acceleration + p[i].forces * (1.0f / p[i].mass);
+			v0[i] = p[i].velocity;
+			if (!p[i].asleep) {
+				p[i].position += p[i].velocity * dt + a0[i] * (0.5f * dt * dt);
+				p[i].velocity += a0[i] * dt;
+			}
+			p[i].forces = base[i];
+		}
+
+		evaluateForces(b, b + n, rng, SteadyForces);
+		for (int i = 0; i < n; i++) {
+			ofVec3f a1 = p[i].acceleration + p[i].forces * (1.0f / p[i].mass);
+			p[i].forces.set(0, 0, 0);
+			if (p[i].asleep) continue;
+			p[i].velocity = v0[i] + (a0[i] + a1) * (0.5f * dt);
+			if (sleepSteps > 0) settle(p[i], a1);
+		}
+	}
+}
+
+// classic fourth order Runge-Kutta on (position, velocity)
+//
+void ParticleSystem::stepRK4(int begin, int end, float dt, RandomStream &rng) {
+	static const float offset[4] = { 0, 0.5f, 0.5f, 1 };
+	static const float weight[4] = { 1, 2, 2, 1 };
+	ofVec3f base[StageBlock], x0[StageBlock], v0[StageBlock];
+	ofVec3f dx[StageBlock], dv[StageBlock], sumX[StageBlock], sumV[StageBlock];
+
+	for (int b = begin; b < end; b += StageBlock) {
+		int n = std::min(StageBlock, end - b);
+		Particle *p = &particles[b];
+		kick(p, n, dt, rng, base);
+		for (int i = 0; i < n; i++) {
+			x0[i] = p[i].position;
+			v0[i] = p[i].velocity;
+			sumX[i].set(0, 0, 0);
+			sumV[i].set(0, 0, 0);
+		}
+
+		for (int s = 0; s < 4; s++) {
+			if (s > 0) {
+				float h = offset[s] * dt;
+				for (int i = 0; i < n; i++) {
+					p[i].position = x0[i] + dx[i] * h;
+					p[i].velocity = v0[i] + dv[i] * h;
+					p[i].forces = base[i];
+				}
+			}
+			evaluateForces(b, b + n, rng, SteadyForces);
+			for (int i = 0; i < n; i++) {
+				dx[i] = p[i].velocity;
+				dv[i] = p[i].acceleration + p[i].forces * (1.0f / p[i].mass);
+				if (p[i].asleep) {
+					dx[i].set(0, 0, 0);
+					dv[i].set(0, 0, 0);
+				}
+				sumX[i] += dx[i] * weight[s];
+				sumV[i] += dv[i] * weight[s];
+			}
+		}
+
+		for (int i = 0; i < n; i++) {
+			p[i].position = x0[i] + sumX[i] * (dt / 6);
+			p[i].velocity = v0[i] + sumV[i] * (dt / 6);
+			p[i].forces.set(0, 0, 0);
+			if (sleepSteps > 0 && !p[i].asleep) settle(p[i], sumV[i] * (1.0f / 6));
+		}
+	}
+}
+
+void ParticleSystem::applyBoundedForces(RandomStream &rng) {
+	for (int k = 0; k < forces.size(); k++) {
+		ParticleForce *f = forces[k];
+		if (f->applied || !f->bounded || f->isThreadSafe()) continue;
+		applyInRegion(*f, [f, &rng](Particle &p) { f->updateForces(&p, 1, rng); });
+	}
+}
+
+// the thread safe forces with a region, on particles [begin, end) at their
+// position at the start of the step.  With region lists only the listed
+// particles are looked at, without every one is tested.
+//
+void ParticleSystem::applyBoundedChunk(int begin, int end, RandomStream &rng) {
+	for (int k = 0; k < forces.size(); k++) {
+		ParticleForce *f = forces[k];
+		if (f->applied || !f->bounded || !f->isThreadSafe()) continue;
+
+		const RegionList *list = nullptr;
+		for (int l = 0; useRegionLists && l < regionLists.size(); l++) {
+			if (regionLists[l].force == f) list = &regionLists[l];
+		}
+		if (list == nullptr) {
+			f->updateForcesInRegion(&particles[begin], end - begin, rng);
+			continue;
+		}
+
+		const vector<int> &idx = list->indices;
+		int c = list->blockFirst[begin / StageBlock];
+		while (c < idx.size() && idx[c] < begin) c++;
+		int m = c;
+		while (m < idx.size() && idx[m] < end) m++;
+		if (m > c) f->updateForcesInRegion(&particles[0], &idx[c], m - c, rng);
+	}
+}
+
+// rebuild the region lists of the thread safe bounded forces if they went
+// stale, see RegionList.  Only symplectic Euler notes how far the
+// particles move, the other integrators test every particle.
+//
+void ParticleSystem::updateRegionLists() {
+	useRegionLists = false;
+	if (integrator != SymplecticEuler) {
+		regionLists.clear();
+		return;
+	}
+
+	bool stale = regionListsDirty || particles.size() != regionListsCount;
+	int live = 0;
+	for (int k = 0; k < forces.size(); k++) {
+		const ParticleForce *f = forces[k];
+		if (f->applied || !f->bounded || !f->isThreadSafe()) continue;
+		if (live == regionLists.size()) regionLists.emplace_back();
+		RegionList &list = regionLists[live++];
+		stale |= list.force != f || list.center != f->regionCenter || list.radius != f->regionRadius;
+		stale |= regionTravel >= f->regionRadius * regionMargin;
+	}
+	regionLists.resize(live);
+	if (live == 0) return;
+
+	if (stale) {
+		int k = 0;
+		for (int j = 0; j < forces.size(); j++) {
+			const ParticleForce *f = forces[j];
+			if (f->applied || !f->bounded || !f->isThreadSafe()) continue;
+			RegionList &list = regionLists[k++];
+			list.force = f;
+			list.center = f->regionCenter;
+			list.radius = f->regionRadius;
+			list.indices.clear();
+			float r = f->regionRadius * (1 + regionMargin);
+			list.blockFirst.clear();
+			for (int i = 0; i < particles.size(); i++) {
+				if (i % StageBlock == 0) list.blockFirst.push_back((int)list.indices.size());
+				if (particles[i].position.squareDistance(list.center) < r * r) list.indices.push_back(i);
+			}
+		}
+		regionTravel = 0;
+		regionListsDirty = false;
+		regionListsCount = particles.size();
+	}
+	chunkTopSpeed.assign((particles.size() + chunkSize - 1) / chunkSize, 0);
+	useRegionLists = true;
+}
+
+bool ParticleSystem::forcesChanged() {
+	bool any = false;
+	for (int k = 0; k < forces.size(); k++) {
+		any |= forces[k]->changed;
+		forces[k]->changed = false;
+	}
+	return any;
+}
+
+// enable sleeping, see sleepSteps.  steps 0 turns it off and wakes
+// everything.
+//
+void ParticleSystem::setSleep(float speed, float accel, int steps) {
+	sleepSpeed = speed;
+	sleepAccel = accel;
+	sleepSteps = steps;
+	if (steps == 0) wakeAll();
+}
+
+void ParticleSystem::wakeAll() {
+	for (int i = 0; i < particles.size(); i++) {
+		particles[i].wake();
+	}
+}
+
+// wake the particles within "dist" of point (something hit them), return
+// how many were asleep
+//
+int ParticleSystem::wakeNear(const ofVec3f & point, float dist) {
+	int woken = 0;
+	forEachNear(point, dist, [&woken](Particle &p) {
+		if (p.asleep) woken++;
+		p.wake();
+	});
+	return woken;
+}
+
+void ParticleSystem::applyForces(int begin, int end, RandomStream &rng, ForceFilter filter) {
+	for (int k = 0; k < forces.size(); k++) {
+		if (!forces[k]->applied && forces[k]->isThreadSafe() && passes(*forces[k], filter))
+			forces[k]->updateForces(&particles[begin], end - begin, rng);
+	}
+}
+
+// update all forces only applied once to "applied"
+// so they are not applied again.
+//
+void ParticleSystem::markApplied() {
 	for (int i = 0; i < forces.size(); i++) {
 		if (forces[i]->applyOnce)
 			forces[i]->applied = true;
 	}
+}
 
-	// integrate all the particles in the store
+// remove the particles which have exceeded their lifespan.  Survivors are
+// moved down in one pass so they keep their order (particle 0 stays first).
+//
+void ParticleSystem::removeExpired() {
+	int n = (int)particles.size();
+	int alive = 0;
+	for (int i = 0; i < n; i++) {
+		Particle &p = particles[i];
+		if (p.lifespan != -1 && p.age(time) > p.lifespan) {
+			releaseHandle(p.handle);
+			continue;
+		}
+		if (alive != i) {
+			particles[alive] = p;
+			if (p.handle >= 0) handleIndex[p.handle] = alive;
+		}
+		alive++;
+	}
+	if (alive != n) {
+		particles.resize(alive);
+		gridDirty = true;
+		regionListsDirty = true;
+	}
+}
+
+// spatial hash over the current particle positions, rebuilt if anything
+// moved since the last query
+//
+const SpatialHash & ParticleSystem::getGrid() {
+	if (gridDirty) {
+		grid.build(particles);
+		gridDirty = false;
+	}
+	return grid;
+}
+
+// remove all particlies within "dist" of point, return how many were removed
+//
+int ParticleSystem::removeNear(const ofVec3f & point, float dist) {
+	int n = (int)particles.size();
+	removeMask.assign(n, 0);
+	int found = 0;
+	getGrid().forEachNear(point, dist, [this, &found](int i) {
+		removeMask[i] = 1;
+		found++;
+	});
+	if (found == 0) return 0;
+
+	// compact the survivors in order, like removeExpired()
 	//
-	for (int i = 0; i < particles.size(); i++) {
-		particles[i].integrate();
+	int alive = 0;
+	for (int i = 0; i < n; i++) {
+		if (removeMask[i]) {
+			releaseHandle(particles[i].handle);
+			continue;
+		}
+		if (alive != i) {
+			particles[alive] = particles[i];
+			if (particles[alive].handle >= 0) handleIndex[particles[alive].handle] = alive;
+		}
+		alive++;
 	}
+	particles.resize(alive);
+	gridDirty = true;
+	regionListsDirty = true;
+	return found;
+}
+
+int ParticleSystem::countNear(const ofVec3f & point, float dist) {
+	return getGrid().countNear(point, dist);
+}
+
+// sort the particles along a Z-order curve through their bounding box
+// (10 bits per axis), so particles close in space are close in the array
+// and a neighbor query or a chunk of the update stays in cache.  Handles
+// follow their particles.
+//
+void ParticleSystem::sortByMorton() {
+	PROFILE_ZONE("ParticleSystem::sortByMorton");
+	int n = (int)particles.size();
+	if (n < 2) return;
+
+	ofVec3f lo = particles[0].position;
+	ofVec3f hi = lo;
+	for (int i = 1; i < n; i++) {
+		const ofVec3f &p = particles[i].position;
+		lo.x = std::min(lo.x, p.x); hi.x = std::max(hi.x, p.x);
+		lo.y = std::min(lo.y, p.y); hi.y = std::max(hi.y, p.y);
+		lo.z = std::min(lo.z, p.z); hi.z = std::max(hi.z, p.z);
+	}
+	ofVec3f ext = hi - lo;
+	ofVec3f scale(1023 / std::max(ext.x, 1e-6f), 1023 / std::max(ext.y, 1e-6f), 1023 / std::max(ext.z, 1e-6f));
+
+	// count the neighbors that are out of order.  Computing the keys is
+	// cheap next to moving the particles, so if the array is still mostly
+	// in order from the last sort leave it alone.
+	//
+	sortKeys.resize(n);
+	sortOrder.resize(n);
+	int unordered = 0;
+	for (int i = 0; i < n; i++) {
+		ofVec3f q = (particles[i].position - lo) * scale;
+		sortKeys[i] = mortonCode((uint32_t)q.x, (uint32_t)q.y, (uint32_t)q.z);
+		sortOrder[i] = i;
+		if (i > 0 && sortKeys[i] < sortKeys[i - 1]) unordered++;
+	}
+	if (unordered < n / 16) return;
+
+	radixSort(sortKeys, sortOrder, sortKeysTmp, sortOrderTmp, 30);
 
+	sortTmp.resize(n);
+	for (int i = 0; i < n; i++) {
+		sortTmp[i] = particles[sortOrder[i]];
+		if (sortTmp[i].handle >= 0) handleIndex[sortTmp[i].handle] = i;
+	}
+	particles.swap(sortTmp);
+	gridDirty = true;
+	regionListsDirty = true;
 }
 
-// remove all particlies within "dist" of point (not implemented as yet)
+// indices of the particles from farthest to nearest to eye, for drawing
+// blended particles back to front.  The particles themselves are not
+// moved.  The result is valid until the next call.
 //
-int ParticleSystem::removeNear(const ofVec3f & point, float dist) { return 0; }
+const vector<int> & ParticleSystem::depthOrder(const ofVec3f & eye) {
+	int n = (int)particles.size();
+	sortKeys.resize(n);
+	sortOrder.resize(n);
+	for (int i = 0; i < n; i++) {
+		sortKeys[i] = floatToSortableKey(-particles[i].position.squareDistance(eye));
+		sortOrder[i] = i;
+	}
+	radixSort(sortKeys, sortOrder, sortKeysTmp, sortOrderTmp);
+	return sortOrder;
+}
 
-//  draw the particle cloud
+//  draw the particle cloud, every particle a sphere of its own radius and
+//  color, all in one draw call (see SphereImpostors)
 //
 void ParticleSystem::draw() {
-	for (int i = 0; i < particles.size(); i++) {
-		particles[i].draw();
+	SphereImpostors &impostors = SphereImpostors::shared();
+	impostors.clear();
+	impostors.instances.reserve(particles.size());
+	for (const Particle &p : particles) {
+		impostors.add(p.position, p.radius, p.color);
 	}
+	impostors.draw();
 }
 
 void ParticleSystem::toggleOnOff(bool en) {
@@ -96,6 +620,102 @@ void ParticleSystem::toggleOnOff(bool en) {
 }
 
 
+// Default batch update - forces that only know how to update a single
+// particle get called once per particle.
+//
+void ParticleForce::updateForces(Particle *particles, int count, RandomStream &rng) {
+	for (int i = 0; i < count; i++) {
+		updateForce(&particles[i]);
+	}
+}
+
+float ParticleForce::weight(const ofVec3f &p) const {
+	if (!bounded) return 1;
+	float d2 = p.squareDistance(regionCenter);
+	float r2 = regionRadius * regionRadius;
+	if (d2 >= r2) return 0;
+	switch (falloff) {
+	case LinearFalloff:
+		return 1 - sqrtf(d2 / r2);
+	case SmoothFalloff: {
+		float t = 1 - d2 / r2;
+		return t * t;
+	}
+	default:
+		return 1;
+	}
+}
+
+bool ParticleForce::touches(const ofVec3f &lo, const ofVec3f &hi) const {
+	if (!bounded) return true;
+	float d2 = 0;
+	for (int k = 0; k < 3; k++) {
+		float c = regionCenter[k];
+		float d = (c < lo[k]) ? lo[k] - c : (c > hi[k]) ? c - hi[k] : 0;
+		d2 += d * d;
+	}
+	return d2 < regionRadius * regionRadius;
+}
+
+// for particles handed in as a block (ParticleSystem::applyBoundedChunk(),
+// CompactParticleSystem): the particles the region reaches go through
+// updateForces() together, the others only cost a distance test
+//
+void ParticleForce::updateForcesInRegion(Particle *particles, int count, RandomStream &rng) {
+	const int blockSize = 64;
+	const float r2 = regionRadius * regionRadius;
+	int inside[blockSize];
+	for (int b = 0; b < count; b += blockSize) {
+		int n = std::min(blockSize, count - b);
+		Particle *p = particles + b;
+		int k = 0;
+		for (int i = 0; i < n; i++) {
+			inside[k] = i;
+			k += p[i].position.squareDistance(regionCenter) < r2;
+		}
+		if (k > 0) updateForcesInRegion(p, inside, k, rng);
+	}
+}
+
+// the candidates with a weight are copied to a stage with their forces
+// cleared, go through updateForces() a stage at a time and add the share
+// of the result their weight gives them.  The weights of a batch are
+// worked out before any of them is looked at, so they do not wait on each
+// other.  The stage is copy constructed into raw storage: a Particle() per
+// slot costs more than most forces.
+//
+void ParticleForce::updateForcesInRegion(Particle *particles, const int *candidates, int count, RandomStream &rng) {
+	const int stageSize = 16;
+	alignas(Particle) unsigned char storage[stageSize * sizeof(Particle)];
+	Particle *stage = reinterpret_cast<Particle *>(storage);
+	int from[stageSize];
+	float w[stageSize];
+	float batch[stageSize];
+	int n = 0;
+	auto flush = [&]() {
+		for (int k = 0; k < n; k++) {
+			new (&stage[k]) Particle(particles[from[k]]);
+			stage[k].forces.set(0, 0, 0);
+		}
+		updateForces(stage, n, rng);
+		for (int k = 0; k < n; k++)
+			particles[from[k]].forces += stage[k].forces * w[k];
+		n = 0;
+	};
+	for (int c = 0; c < count; c += stageSize) {
+		int m = std::min(stageSize, count - c);
+		for (int j = 0; j < m; j++)
+			batch[j] = weight(particles[candidates[c + j]].position);
+		for (int j = 0; j < m; j++) {
+			from[n] = candidates[c + j];
+			w[n] = batch[j];
+			n += batch[j] > 0;
+			if (n == stageSize) flush();
+		}
+	}
+	if (n > 0) flush();
+}
+
 // Gravity Force Field 
 //
 GravityForce::GravityForce(const ofVec3f &g) {
@@ -109,6 +729,16 @@ void GravityForce::updateForce(Particle * particle) {
 	particle->forces += gravity * particle->mass;
 }
 
+void GravityForce::updateForces(Particle *particles, int count, RandomStream &rng) {
+	const float gx = gravity.x, gy = gravity.y, gz = gravity.z;
+	for (int i = 0; i < count; i++) {
+		Particle &p = particles[i];
+		p.forces.x += gx * p.mass;
+		p.forces.y += gy * p.mass;
+		p.forces.z += gz * p.mass;
+	}
+}
+
 // Turbulence Force Field 
 //
 TurbulenceForce::TurbulenceForce(const ofVec3f &min, const ofVec3f &max) {
@@ -121,9 +751,24 @@ void TurbulenceForce::updateForce(Particle * particle) {
 	// We are going to add a little "noise" to a particles
 	// forces to achieve a more natual look to the motion
 	//
-	particle->forces.x += ofRandom(tmin.x, tmax.x);
-	//particle->forces.y += ofRandom(tmin.y, tmax.y);
-	particle->forces.z += ofRandom(tmin.z, tmax.z);
+	particle->forces.x += singleRng.uniform(tmin.x, tmax.x);
+	//particle->forces.y += singleRng.uniform(tmin.y, tmax.y);
+	particle->forces.z += singleRng.uniform(tmin.z, tmax.z);
+}
+
+void TurbulenceForce::updateForces(Particle *particles, int count, RandomStream &rng) {
+	// draw the noise a block at a time with the bulk generator
+	//
+	float rx[256], rz[256];
+	for (int begin = 0; begin < count; begin += 256) {
+		int n = std::min(256, count - begin);
+		rng.fill(rx, n, tmin.x, tmax.x);
+		rng.fill(rz, n, tmin.z, tmax.z);
+		for (int i = 0; i < n; i++) {
+			particles[begin + i].forces.x += rx[i];
+			particles[begin + i].forces.z += rz[i];
+		}
+	}
 }
 
 // Impulse Radial Force - this is a "one shot" force that
@@ -139,10 +784,25 @@ void ImpulseRadialForce::updateForce(Particle * particle) {
 	// we basically create a random direction for each particle
 	// the force is only added once after it is triggered.
 	//
-	ofVec3f dir = ofVec3f(ofRandom(-1, 1), ofRandom(-height/2.0, height/2.0), ofRandom(-1, 1));
+	ofVec3f dir = ofVec3f(singleRng.uniform(-1, 1), singleRng.uniform(-height/2.0, height/2.0), singleRng.uniform(-1, 1));
 	particle->forces += dir.getNormalized() * magnitude;
 }
 
+void ImpulseRadialForce::updateForces(Particle *particles, int count, RandomStream &rng) {
+	const float h = height / 2.0;
+	float rx[256], ry[256], rz[256];
+	for (int begin = 0; begin < count; begin += 256) {
+		int n = std::min(256, count - begin);
+		rng.fill(rx, n, -1, 1);
+		rng.fill(ry, n, -h, h);
+		rng.fill(rz, n, -1, 1);
+		for (int i = 0; i < n; i++) {
+			ofVec3f dir = ofVec3f(rx[i], ry[i], rz[i]);
+			particles[begin + i].forces += dir.getNormalized() * magnitude;
+		}
+	}
+}
+
 CyclicForce::CyclicForce(float magnitude) {
 	this->magnitude = magnitude;
 }
@@ -155,6 +815,38 @@ void CyclicForce::updateForce(Particle * particle) {
 	particle->forces += dir.getNormalized() * magnitude;
 }
 
+void CyclicForce::updateForces(Particle *particles, int count, RandomStream &rng) {
+
+	// norm x (0, 1, 0) = (-norm.z, 0, norm.x), and normalizing the position
+	// first does not change the direction of the result, so only the xz
+	// length is needed.
+	//
+	for (int i = 0; i < count; i++) {
+		Particle &p = particles[i];
+		float lenSq = p.position.x * p.position.x + p.position.z * p.position.z;
+		if (lenSq <= 0) continue;
+		float s = magnitude / sqrtf(lenSq);
+		p.forces.x += -p.position.z * s;
+		p.forces.z += p.position.x * s;
+	}
+}
+
+// Drag Force - slows the particle in proportion to its velocity
+//
+void DragForce::updateForce(Particle * particle) {
+	particle->forces -= particle->velocity * (k * particle->mass);
+}
+
+void DragForce::updateForces(Particle *particles, int count, RandomStream &rng) {
+	for (int i = 0; i < count; i++) {
+		Particle &p = particles[i];
+		float s = k * p.mass;
+		p.forces.x -= p.velocity.x * s;
+		p.forces.y -= p.velocity.y * s;
+		p.forces.z -= p.velocity.z * s;
+	}
+}
+
 Thruster::Thruster(ofVec3f dir) {
 	this->direction = dir;
 }
@@ -165,6 +857,18 @@ void Thruster::updateForce(Particle * particle) {
 	//cout << direction << endl;
 }
 
+void Thruster::updateForces(Particle *particles, int count, RandomStream &rng) {
+	const float tx = direction.x * magnitude;
+	const float ty = direction.y * magnitude;
+	const float tz = direction.z * magnitude;
+	for (int i = 0; i < count; i++) {
+		Particle &p = particles[i];
+		p.forces.x += tx * p.mass;
+		p.forces.y += ty * p.mass;
+		p.forces.z += tz * p.mass;
+	}
+}
+
 //Impulse Force
 void ImpulseForce::updateForce(Particle * particle) {
 
@@ -172,3 +876,9 @@ void ImpulseForce::updateForce(Particle * particle) {
 	particle->forces += force;
 	
 }
+
+void ImpulseForce::updateForces(Particle *particles, int count, RandomStream &rng) {
+	for (int i = 0; i < count; i++) {
+		particles[i].forces += force;
+	}
+}
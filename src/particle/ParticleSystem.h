@@ -3,44 +3,267 @@
 
 #include "ofMain.h"
 #include "Particle.h"
+#include "SpatialHash.h"
+#include "ParticleBudget.h"
+#include "../utils/Random.h"
 
 
 //  Pure Virtual Function Class - must be subclassed to create new forces.
 //
+//  ParticleSystem applies forces through updateForces() on the whole
+//  particle array at once.  The default falls back to updateForce() for
+//  every particle so user forces only need the per-particle method; the
+//  built-in forces override the batch version with a flat loop.  Random
+//  forces draw from the stream they are handed, never from ofRandom(),
+//  so they stay reproducible and can run on worker threads.
+//
 class ParticleForce {
 protected:
 public:
 	bool applyOnce = false;
 	bool applied = false;
+	bool changed = false;     // set() gave it a new value, wakes sleeping particles
+	virtual ~ParticleForce() {}
 	virtual void updateForce(Particle *) = 0;
+	virtual void updateForces(Particle *particles, int count, RandomStream &rng);
+
+	// true if updateForces() may run on several chunks of the array at
+	// the same time.  Forces that touch shared state must say no, they are
+	// then applied on the calling thread before the parallel pass.
+	virtual bool isThreadSafe() const { return false; }
+
+	// optional region of effect: a sphere the force fades out in.  A
+	// bounded force is only applied to the particles inside it, at their
+	// position at the start of the step.  Moving the region does not wake
+	// sleeping particles.
+	//
+	enum Falloff { NoFalloff, LinearFalloff, SmoothFalloff };
+	bool bounded = false;
+	ofVec3f regionCenter;
+	float regionRadius = 0;
+	Falloff falloff = NoFalloff;
+
+	void setRegion(const ofVec3f &center, float radius, Falloff f = NoFalloff) {
+		bounded = true;
+		regionCenter = center;
+		regionRadius = radius;
+		falloff = f;
+	}
+	void clearRegion() { bounded = false; }
+	float weight(const ofVec3f &p) const;              // 1 at the center, 0 outside
+	bool touches(const ofVec3f &lo, const ofVec3f &hi) const;   // region overlaps the box
+
+	// updateForces() scaled by the weight of each particle, run only on the
+	// particles inside the region: all of them tested, or only the listed
+	// candidates (ascending indices into particles)
+	void updateForcesInRegion(Particle *particles, int count, RandomStream &rng);
+	void updateForcesInRegion(Particle *particles, const int *candidates, int count, RandomStream &rng);
+};
+
+//  How ParticleSystem advances its particles by one step.
+//
+//  SymplecticEuler is Particle::integrate() (velocity first, then position
+//  with the new velocity) and evaluates the forces once per step.
+//  VelocityVerlet evaluates them twice and RK4 four times, on trial states
+//  of the particle, in exchange for a much smaller error per step.
+//
+enum Integrator {
+	SymplecticEuler,
+	VelocityVerlet,
+	RK4,
 };
 
+const char * integratorName(Integrator i);
+
 class ParticleSystem {
 public:
-	void add(const Particle &);
+	virtual ~ParticleSystem() { if (budget) budget->untrack(this); }
+	int add(const Particle &);
+	Particle * addBlock(int n, const Particle &proto);
+	Particle * get(int handle);
+	int indexOf(int handle) const;
 	void addForce(ParticleForce *);
 	void remove(int);
-	void update();
+	void update(float dt);
+	void removeExpired();
+	void setThreaded(bool b) { threaded = b; }
+	void setSeed(uint64_t s) { seed = s; }
+	void setIntegrator(Integrator i) { integrator = i; }
+	void setSleep(float speed, float accel, int steps);
+	void wakeAll();
+	int wakeNear(const ofVec3f & point, float dist);
 	void toggleOnOff(bool);
 	void setLifespan(float);
 	void reset();
 	int removeNear(const ofVec3f & point, float dist);
+	int countNear(const ofVec3f & point, float dist);
+	template <typename Fn>
+	void forEachNear(const ofVec3f & point, float dist, Fn fn);   // fn(Particle &)
+	const SpatialHash & getGrid();
+	template <typename Fn>
+	void applyInRegion(const ParticleForce &f, Fn apply);     // apply(Particle &)
+	void setGridCellSize(float s) { grid.setCellSize(s); gridDirty = true; }
+	void invalidateGrid() { gridDirty = true; regionListsDirty = true; }
 	void draw();
+	void setReorderInterval(int n) { reorderInterval = n; }
+	void sortByMorton();
+	const vector<int> & depthOrder(const ofVec3f & eye);
 	vector<Particle> particles;
 	vector<ParticleForce *> forces;
 	bool enabled = true;
+	Integrator integrator = SymplecticEuler;
+	double time = 0;    // sec of simulated time, advanced by update().  double
+	                    // like SimClock, a float stops gaining dt after hours
+	unsigned long steps = 0;
+
+	// random streams handed to the forces are derived from (seed, step,
+	// chunk), so a run with the same seed is repeated exactly.
+	uint64_t seed = 1;
+
+	// parallel update on ThreadPool::shared().  Below parallelThreshold
+	// particles the work is not worth the hand off and runs serially.
+	// Results are identical either way.
+	bool threaded = false;
+	int parallelThreshold = 4096;
+	int chunkSize = 1024;
+
+	// neighbor queries go through a spatial hash which is rebuilt (O(n))
+	// on the first query after the particles have moved or changed
+	SpatialHash grid;
+	bool gridDirty = true;
+
+	// the thread safe bounded forces only test the particles listed near
+	// their region, see updateRegionLists().  A list takes in regionMargin
+	// times the radius more than the region and is kept until the fastest
+	// particle could have crossed that, or particles are added, removed or
+	// reordered.  Particles moved from outside update() need invalidateGrid().
+	struct RegionList {
+		const ParticleForce *force = nullptr;
+		ofVec3f center;
+		float radius = 0;
+		vector<int> indices;        // ascending
+		vector<int> blockFirst;     // per StageBlock of particles, its first entry in indices
+	};
+	vector<RegionList> regionLists;
+	float regionMargin = 0.1f;
+	float regionTravel = 0;         // farthest a particle moved since the lists were built
+	bool regionListsDirty = true;
+	bool useRegionLists = false;
+	size_t regionListsCount = 0;    // particles when the lists were built
+	vector<float> chunkTopSpeed;    // squared, per chunk of the step
+	vector<char> removeMask;
+
+	// set by ParticleBudget::track(), update() then reports its cost
+	ParticleBudget *budget = nullptr;
+
+	// particles move around in the array (removal, sorting), a handle
+	// from add() keeps finding the same one.  handleIndex maps a handle
+	// to its current index, -1 if the handle is free.
+	vector<int> handleIndex;
+	vector<int> freeHandles;
+
+	// every reorderInterval steps (0 = never) the particles are sorted by
+	// the Morton code of their position, so neighbors in space are
+	// neighbors in memory.  Small or already well ordered systems are
+	// skipped, the sort would cost more than it saves.  Off by default:
+	// it pays for bounded forces and spatial queries on large systems, a
+	// plain update only gets slower (tools/bench particles/update*, reorder).
+	int reorderInterval = 0;
+	int reorderMinParticles = 2048;
+	vector<uint32_t> sortKeys, sortKeysTmp;
+	vector<int> sortOrder, sortOrderTmp;
+	vector<Particle> sortTmp;
+
+	// a particle whose speed and acceleration stay under sleepSpeed and
+	// sleepAccel for sleepSteps steps in a row falls asleep: it is no
+	// longer integrated until a force of the system changes or it is woken
+	// (wakeNear() for contacts).  sleepSteps 0 = never sleep.
+	float sleepSpeed = 0.05f;
+	float sleepAccel = 0.05f;
+	int sleepSteps = 0;
+
+protected:
+	// one chunk of the per particle work of update(), see StaticParticleSystem
+	virtual void stepChunk(int begin, int end, float dt, RandomStream &rng);
+	virtual void markApplied();
+	void step(float dt);
+
+	// which forces an evaluation adds: one shot forces (impulses) are given
+	// to the multi stage integrators separately, as a kick of the velocity
+	enum ForceFilter { AllForces, SteadyForces, OneShotForces };
+	static bool passes(const ParticleForce &f, ForceFilter filter) {
+		if (f.bounded) return false;
+		return filter == AllForces || f.applyOnce == (filter == OneShotForces);
+	}
+	void applyForces(int begin, int end, RandomStream &rng, ForceFilter filter = AllForces);
+
+	// add the thread safe forces to particles [begin, end), called once per
+	// stage of the integrator
+	virtual void evaluateForces(int begin, int end, RandomStream &rng, ForceFilter filter = AllForces) {
+		applyForces(begin, end, rng, filter);
+	}
+	void kick(Particle *p, int n, float dt, RandomStream &rng, ofVec3f *base);
+
+	// true if a force got a new value since the last call
+	virtual bool forcesChanged();
+	virtual void applyBoundedForces(RandomStream &rng);
+	void applyBoundedChunk(int begin, int end, RandomStream &rng);
+	void updateRegionLists();
+	void noteTopSpeed(int begin, float top) {    // squared, from the integrate loop
+		if (!useRegionLists) return;
+		float &chunkTop = chunkTopSpeed[begin / chunkSize];
+		chunkTop = std::max(chunkTop, top);
+	}
+	void settle(Particle &p, const ofVec3f &accel) {
+		if (p.velocity.lengthSquared() < sleepSpeed * sleepSpeed && accel.lengthSquared() < sleepAccel * sleepAccel) {
+			if (++p.stillSteps >= sleepSteps) p.sleep();
+		}
+		else p.stillSteps = 0;
+	}
+	static const int StageBlock = 64;    // particles per block of the chunk kernels
+	void stepVerlet(int begin, int end, float dt, RandomStream &rng);
+	void stepRK4(int begin, int end, float dt, RandomStream &rng);
+	int newHandle(int index);
+	void releaseHandle(int handle);
 };
 
 
+template <typename Fn>
+void ParticleSystem::forEachNear(const ofVec3f & point, float dist, Fn fn) {
+	const SpatialHash &g = getGrid();
+	g.forEachNear(point, dist, [this, &fn](int i) { fn(particles[i]); });
+}
+
+// run apply on every particle in the region of f, scaling what it adds
+// to the forces of the particle by the falloff
+//
+template <typename Fn>
+void ParticleSystem::applyInRegion(const ParticleForce &f, Fn apply) {
+	forEachNear(f.regionCenter, f.regionRadius, [&f, &apply](Particle &p) {
+		float w = f.weight(p.position);
+		if (w <= 0) return;
+		if (w >= 1) {
+			apply(p);
+			return;
+		}
+		ofVec3f before = p.forces;
+		apply(p);
+		p.forces = before + (p.forces - before) * w;
+	});
+}
+
 
 // Some convenient built-in forces
 //
 class GravityForce: public ParticleForce {
 	ofVec3f gravity;
 public:
-	void set(const ofVec3f &g) { gravity = g; }
+	bool isThreadSafe() const { return true; }
+	void set(const ofVec3f &g) { changed |= (g != gravity); gravity = g; }
 	GravityForce(const ofVec3f & gravity);
+	GravityForce() {}
 	void updateForce(Particle *);
+	void updateForces(Particle *particles, int count, RandomStream &rng);
 	ofVec3f getForce() {
 		return this->gravity;
 	}
@@ -48,31 +271,55 @@ public:
 
 class TurbulenceForce : public ParticleForce {
 	ofVec3f tmin, tmax;
+	RandomStream singleRng;   // for single particle updateForce() calls
 public:
-	void set(const ofVec3f &min, const ofVec3f &max) { tmin = min; tmax = max; }
+	bool isThreadSafe() const { return true; }
+	void set(const ofVec3f &min, const ofVec3f &max) {
+		changed |= (min != tmin || max != tmax);
+		tmin = min;
+		tmax = max;
+	}
 	TurbulenceForce(const ofVec3f & min, const ofVec3f &max);
 	TurbulenceForce() { tmin.set(0, 0, 0); tmax.set(0, 0, 0); }
 	void updateForce(Particle *);
+	void updateForces(Particle *particles, int count, RandomStream &rng);
 };
 
 class ImpulseRadialForce : public ParticleForce {
 	float magnitude = 1.0;
 	float height = .2;
+	RandomStream singleRng;   // for single particle updateForce() calls
 public:
-	void set(float mag) { magnitude = mag; }
+	bool isThreadSafe() const { return true; }
+	void set(float mag) { changed |= (mag != magnitude); magnitude = mag; }
 	void setHeight(float h) { height = h; }
 	ImpulseRadialForce(float magnitude);
 	ImpulseRadialForce() {}
 	void updateForce(Particle *);
+	void updateForces(Particle *particles, int count, RandomStream &rng);
 };
 
 class CyclicForce : public ParticleForce {
 	float magnitude = 1.0;
 public:
-	void set(float mag) { magnitude = mag; }
+	bool isThreadSafe() const { return true; }
+	void set(float mag) { changed |= (mag != magnitude); magnitude = mag; }
 	CyclicForce(float magnitude);  
 	CyclicForce() {}
 	void updateForce(Particle *);
+	void updateForces(Particle *particles, int count, RandomStream &rng);
+};
+
+// linear drag, f = -k m v
+class DragForce : public ParticleForce {
+	float k = 0;
+public:
+	bool isThreadSafe() const { return true; }
+	void set(float drag) { changed |= (drag != k); k = drag; }
+	DragForce(float drag) { k = drag; }
+	DragForce() {}
+	void updateForce(Particle *);
+	void updateForces(Particle *particles, int count, RandomStream &rng);
 };
 
 // Thruster force should be greater than abs(gravity)
@@ -80,14 +327,20 @@ class Thruster : public ParticleForce {
 	float magnitude = 0;
 	ofVec3f direction;
 public:
-	void set(ofVec3f dir, float mag) { this->direction = dir; this->magnitude = mag; }
+	bool isThreadSafe() const { return true; }
+	void set(ofVec3f dir, float mag) {
+		changed |= (dir != direction || mag != magnitude);
+		this->direction = dir;
+		this->magnitude = mag;
+	}
 
 	Thruster(ofVec3f dir);
 	Thruster(){}
 	void updateForce(Particle *);
+	void updateForces(Particle *particles, int count, RandomStream &rng);
 
 	ofVec3f getForce() {
-		return ofVec3f(0,magnitude,0);
+		return direction * magnitude;
 	}
 };
 
@@ -95,6 +348,7 @@ public:
 class ImpulseForce : public ParticleForce {
 	ofVec3f force;
 public:
+	bool isThreadSafe() const { return true; }
 	ImpulseForce() {
 		applyOnce = true;
 		applied = true;
@@ -105,9 +359,11 @@ public:
 		force = (materialRes + 1) * (glm::dot(f, normal)) * normal;
 		//cout << force << endl;
 		applied = false;
+		changed = true;
 	}
 
 	void updateForce(Particle * particle);
+	void updateForces(Particle *particles, int count, RandomStream &rng);
 
 	ofVec3f getForce() {
 		return this->force;
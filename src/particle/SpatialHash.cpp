@@ -0,0 +1,52 @@
+#include "SpatialHash.h"
+
+SpatialHash::SpatialHash(float cellSize) {
+	setCellSize(cellSize);
+}
+
+void SpatialHash::build(const vector<Particle> &particles) {
+	data = particles.empty() ? nullptr : &particles[0];
+	count = (int)particles.size();
+
+	// about two buckets per particle keeps collisions rare
+	//
+	int size = 64;
+	while (size < count * 2) size *= 2;
+	tableSize = size;
+
+	cellStart.assign(tableSize + 1, 0);
+	sorted.resize(count);
+	bucketOf.resize(count);
+
+	// count particles per bucket
+	//
+	for (int i = 0; i < count; i++) {
+		const ofVec3f &p = particles[i].position;
+		int b = bucket(cellCoord(p.x), cellCoord(p.y), cellCoord(p.z));
+		bucketOf[i] = b;
+		cellStart[b + 1]++;
+	}
+
+	// prefix sum gives the first slot of every bucket
+	//
+	for (int b = 0; b < tableSize; b++) {
+		cellStart[b + 1] += cellStart[b];
+	}
+
+	// scatter, moving each bucket's write position forward
+	//
+	cursor.assign(cellStart.begin(), cellStart.end() - 1);
+	for (int i = 0; i < count; i++) {
+		sorted[cursor[bucketOf[i]]++] = i;
+	}
+}
+
+int SpatialHash::countNear(const ofVec3f &point, float radius) const {
+	int n = 0;
+	forEachNear(point, radius, [&n](int) { n++; });
+	return n;
+}
+
+void SpatialHash::queryNear(const ofVec3f &point, float radius, vector<int> &indicesRtn) const {
+	forEachNear(point, radius, [&indicesRtn](int i) { indicesRtn.push_back(i); });
+}
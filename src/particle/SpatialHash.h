@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Particle.h"
+
+//  Uniform spatial hash over particle positions.
+//
+//  Space is cut into cubes of cellSize and every cube is hashed into a
+//  table of buckets.  build() sorts the particle indices by bucket with a
+//  counting sort (two linear passes), reusing its arrays from the last
+//  build, so rebuilding every frame is O(n) with no allocation.  Radius
+//  queries only look at the cells overlapping the query sphere, i.e. they
+//  cost O(k) in the number of particles nearby, not in the system size.
+//
+//  Indices refer to the particle array passed to build() and are only
+//  valid until that array changes.
+//
+class SpatialHash {
+public:
+	SpatialHash(float cellSize = 1.0);
+
+	void setCellSize(float s) { cellSize = s; invCellSize = 1.0 / s; }
+	void build(const vector<Particle> &particles);
+
+	// call fn(index) for every particle within radius of point
+	template <typename Fn>
+	void forEachNear(const ofVec3f &point, float radius, Fn fn) const;
+
+	int countNear(const ofVec3f &point, float radius) const;
+	void queryNear(const ofVec3f &point, float radius, vector<int> &indicesRtn) const;
+
+	float cellSize;
+
+private:
+	int cellCoord(float v) const { return (int)floorf(v * invCellSize); }
+	int bucket(int ix, int iy, int iz) const {
+		unsigned int h = (unsigned int)ix * 73856093u ^ (unsigned int)iy * 19349663u ^ (unsigned int)iz * 83492791u;
+		return (int)(h & (unsigned int)(tableSize - 1));
+	}
+
+	float invCellSize;
+	int tableSize = 0;                 // power of two
+	const Particle *data = nullptr;
+	int count = 0;
+	vector<int> cellStart;             // tableSize + 1 offsets into sorted
+	vector<int> sorted;                // particle indices grouped by bucket
+	vector<int> bucketOf;              // bucket of each particle
+	vector<int> cursor;                // scatter position per bucket
+};
+
+template <typename Fn>
+void SpatialHash::forEachNear(const ofVec3f &point, float radius, Fn fn) const {
+	if (count == 0) return;
+	const float r2 = radius * radius;
+
+	int x0 = cellCoord(point.x - radius), x1 = cellCoord(point.x + radius);
+	int y0 = cellCoord(point.y - radius), y1 = cellCoord(point.y + radius);
+	int z0 = cellCoord(point.z - radius), z1 = cellCoord(point.z + radius);
+
+	// a query larger than the table would visit buckets over and over,
+	// scanning every particle once is cheaper then.
+	//
+	long long cells = (long long)(x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1);
+	if (cells > tableSize) {
+		for (int i = 0; i < count; i++) {
+			if ((data[i].position - point).lengthSquared() <= r2) fn(i);
+		}
+		return;
+	}
+
+	for (int ix = x0; ix <= x1; ix++) {
+		for (int iy = y0; iy <= y1; iy++) {
+			for (int iz = z0; iz <= z1; iz++) {
+				int b = bucket(ix, iy, iz);
+				for (int k = cellStart[b]; k < cellStart[b + 1]; k++) {
+					int i = sorted[k];
+					const ofVec3f &p = data[i].position;
+
+					// several cells can share a bucket, only take the
+					// particles that really are in this cell so none
+					// is reported twice
+					//
+					if (cellCoord(p.x) != ix || cellCoord(p.y) != iy || cellCoord(p.z) != iz) continue;
+					if ((p - point).lengthSquared() <= r2) fn(i);
+				}
+			}
+		}
+	}
+}
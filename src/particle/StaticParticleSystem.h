@@ -0,0 +1,147 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+#include "ParticleSystem.h"
+
+//  Particle system with a force set fixed at compile time.
+//
+//  The forces are stored by value and listed as template arguments, e.g.
+//
+//      StaticParticleSystem<GravityForce, Thruster> sys;
+//      sys.force<1>().set(ofVec3f(0, 1, 0), 5);
+//
+//  update() walks each chunk in blocks of StageBlock particles: every force
+//  adds itself to the block through its own batch updateForces(), called
+//  on the concrete type so there is no virtual dispatch, and the block is
+//  integrated while it is still in cache.  Forces added at runtime with
+//  addForce() still work and are applied first, like in ParticleSystem.
+//  The blocked loop is used with the default integrator, the others go
+//  through evaluateForces() once per stage.
+//
+template <typename... Forces>
+class StaticParticleSystem : public ParticleSystem {
+public:
+	typedef std::tuple<Forces...> ForceSet;
+	static const int numForces = sizeof...(Forces);
+
+	template <int I>
+	typename std::tuple_element<I, ForceSet>::type & force() {
+		return std::get<I>(staticForces);
+	}
+
+	ForceSet staticForces;
+
+protected:
+	typedef std::index_sequence_for<Forces...> Indices;
+
+	void stepChunk(int begin, int end, float dt, RandomStream &rng) {
+
+		// the multi stage integrators evaluate the forces through
+		// evaluateForces() below
+		//
+		if (integrator != SymplecticEuler) {
+			ParticleSystem::stepChunk(begin, end, dt, rng);
+			return;
+		}
+
+		applyBoundedChunk(begin, end, rng);
+
+		// which forces are live this step (one shot forces already applied
+		// are skipped), decided once per chunk and not per block.
+		//
+		bool active[numForces + 1];
+		gatherActive(active, Indices());
+
+		for (int b = begin; b < end; b += StageBlock) {
+			int n = std::min(StageBlock, end - b);
+			Particle *p = &particles[b];
+			applyForces(b, b + n, rng);
+			applyAll(p, n, rng, active, Indices());
+			float top = 0;
+			for (int i = 0; i < n; i++) {
+				if (p[i].asleep) {
+					p[i].forces.set(0, 0, 0);
+					continue;
+				}
+				if (sleepSteps > 0) {
+					ofVec3f accel = p[i].acceleration + p[i].forces * (1.0f / p[i].mass);
+					p[i].integrate(dt);
+					settle(p[i], accel);
+				}
+				else p[i].integrate(dt);
+				top = std::max(top, p[i].velocity.lengthSquared());
+			}
+			noteTopSpeed(b, top);
+		}
+	}
+
+	void evaluateForces(int begin, int end, RandomStream &rng, ForceFilter filter) {
+		applyForces(begin, end, rng, filter);
+		bool active[numForces + 1];
+		gatherActive(active, Indices(), filter);
+		applyAll(&particles[begin], end - begin, rng, active, Indices());
+	}
+
+	void markApplied() {
+		ParticleSystem::markApplied();
+		markAll(Indices());
+	}
+
+	bool forcesChanged() {
+		bool any = ParticleSystem::forcesChanged();
+		return changedAll(Indices()) || any;
+	}
+
+	void applyBoundedForces(RandomStream &rng) {
+		ParticleSystem::applyBoundedForces(rng);
+		boundedAll(rng, Indices());
+	}
+
+private:
+	template <size_t... I>
+	void gatherActive(bool *active, std::index_sequence<I...>, ForceFilter filter = AllForces) {
+		int expand[] = { 0, (active[I] = !std::get<I>(staticForces).applied &&
+			passes(std::get<I>(staticForces), filter), 0)... };
+		(void)expand;
+	}
+
+	// the qualified call names the override of F, no virtual dispatch
+	//
+	template <typename F>
+	static void applyBlock(F &f, Particle *p, int n, RandomStream &rng) {
+		f.F::updateForces(p, n, rng);
+	}
+
+	template <size_t... I>
+	void applyAll(Particle *p, int n, RandomStream &rng, const bool *active, std::index_sequence<I...>) {
+		int expand[] = { 0, (active[I] ? applyBlock(std::get<I>(staticForces), p, n, rng) : (void)0, 0)... };
+		(void)expand;
+	}
+
+	template <typename F>
+	void applyBounded(F &f, RandomStream &rng) {
+		if (f.applied || !f.bounded) return;
+		applyInRegion(f, [&f, &rng](Particle &p) { applyBlock(f, &p, 1, rng); });
+	}
+
+	template <size_t... I>
+	void boundedAll(RandomStream &rng, std::index_sequence<I...>) {
+		int expand[] = { 0, (applyBounded(std::get<I>(staticForces), rng), 0)... };
+		(void)expand;
+	}
+
+	template <size_t... I>
+	bool changedAll(std::index_sequence<I...>) {
+		bool any = false;
+		int expand[] = { 0, (any |= std::get<I>(staticForces).changed, std::get<I>(staticForces).changed = false, 0)... };
+		(void)expand;
+		return any;
+	}
+
+	template <size_t... I>
+	void markAll(std::index_sequence<I...>) {
+		int expand[] = { 0, (std::get<I>(staticForces).applied |= std::get<I>(staticForces).applyOnce, 0)... };
+		(void)expand;
+	}
+};
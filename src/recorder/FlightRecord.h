@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+
+//  On-disk layout of a flight recording (.flr), shared by FlightRecorder
+//  and FlightRecordReader.  Nothing here depends on openFrameworks.
+//
+//  A file is a FileHeader, its table of ColumnDesc and then any number of
+//  blocks.  A block holds up to rowsPerBlock consecutive simulation steps
+//  stored column by column, so reading one channel of a flight only
+//  touches the bytes of that channel.  All fields are little endian and
+//  naturally aligned, and every block and every column in a block starts
+//  on an 8 byte boundary, so a mapped file can be read in place.
+//
+//  Columns are looked up by name.  Adding a column keeps the version,
+//  changing the meaning or layout of an existing one bumps it.
+//
+namespace flightrec {
+
+const uint32_t FileMagic = 0x52464C53;     // "SLFR"
+const uint32_t BlockMagic = 0x4B4C4246;    // "FBLK"
+const uint16_t Version = 1;
+
+enum ColumnType {
+	U8 = 0,
+	U32 = 1,
+	F32 = 2,
+};
+
+inline int typeSize(int type) {
+	return (type == U8) ? 1 : 4;
+}
+
+inline uint32_t align8(uint32_t n) {
+	return (n + 7) & ~7u;
+}
+
+struct FileHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t headerSize;     // sizeof(FileHeader) of the writer, the column table follows
+	uint32_t columnCount;
+	uint32_t rowsPerBlock;
+	float    dt;             // sec per simulation step
+	uint32_t reserved;
+};
+
+struct ColumnDesc {
+	char     name[24];       // zero terminated
+	uint8_t  type;           // ColumnType
+	uint8_t  components;     // 3 for a vector
+	uint16_t reserved;
+	uint32_t reserved2;
+};
+
+struct BlockHeader {
+	uint32_t magic;
+	uint32_t rows;
+	uint64_t firstStep;
+};
+
+// bit values of the "flags" column
+//
+enum Flags {
+	GroundTouched = 1,
+	CompleteStopped = 2,
+	Hanging = 4,
+	EmitterOn = 8,
+	TargetSelected = 16,
+};
+
+}
@@ -0,0 +1,156 @@
+
+#include "FlightRecordReader.h"
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace flightrec;
+
+bool FlightRecordReader::open(const std::string &path) {
+	close();
+
+#ifdef _WIN32
+	HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f == INVALID_HANDLE_VALUE) {
+		error = "can't open " + path;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(f, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+	fileHandle = f;
+	if (size > 0) {
+		mapHandle = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapHandle) data = (const uint8_t *)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		error = "can't open " + path;
+		return false;
+	}
+	struct stat st;
+	fstat(fd, &st);
+	size = (size_t)st.st_size;
+	if (size > 0) {
+		void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) data = (const uint8_t *)p;
+	}
+	::close(fd);
+#endif
+	if (data == NULL) {
+		error = "can't map " + path;
+		close();
+		return false;
+	}
+
+	// header and column table
+	//
+	header = (const FileHeader *)data;
+	if (size < sizeof(FileHeader) || header->magic != FileMagic) {
+		error = path + " is not a flight recording";
+		close();
+		return false;
+	}
+	if (header->version > Version) {
+		error = path + " was written by a newer version (" + std::to_string(header->version) + ")";
+		close();
+		return false;
+	}
+
+	// a header shorter than ours would overlap the column table, one past
+	// the end of the file is garbage
+	//
+	size_t offset = header->headerSize;
+	if (offset < sizeof(FileHeader) || offset > size) {
+		error = path + " has a bad header size (" + std::to_string(offset) + ")";
+		close();
+		return false;
+	}
+	if (header->columnCount > (size - offset) / sizeof(ColumnDesc)) {
+		error = path + " is truncated";
+		close();
+		return false;
+	}
+	columns = (const ColumnDesc *)(data + offset);
+	offset = align8((uint32_t)(offset + header->columnCount * sizeof(ColumnDesc)));
+
+	// walk the blocks, stopping at the first incomplete one
+	//
+	while (offset + sizeof(BlockHeader) <= size) {
+		const BlockHeader *block = (const BlockHeader *)(data + offset);
+		if (block->magic != BlockMagic || block->rows > header->rowsPerBlock) break;
+		size_t bytes = 0;
+		for (int c = 0; c < columnCount(); c++)
+			bytes += align8(block->rows * typeSize(columns[c].type) * columns[c].components);
+		if (offset + sizeof(BlockHeader) + bytes > size) break;
+		blocks.push_back(offset);
+		rows += block->rows;
+		offset += sizeof(BlockHeader) + bytes;
+	}
+	return true;
+}
+
+void FlightRecordReader::close() {
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapHandle) CloseHandle(mapHandle);
+	if (fileHandle) CloseHandle(fileHandle);
+	mapHandle = NULL;
+	fileHandle = NULL;
+#else
+	if (data) munmap((void *)data, size);
+#endif
+	data = NULL;
+	size = 0;
+	header = NULL;
+	columns = NULL;
+	blocks.clear();
+	rows = 0;
+}
+
+int FlightRecordReader::findColumn(const char *name) const {
+	for (int c = 0; c < columnCount(); c++) {
+		if (strncmp(columns[c].name, name, sizeof(columns[c].name)) == 0) return c;
+	}
+	return -1;
+}
+
+int FlightRecordReader::blockRows(int b) const {
+	return ((const BlockHeader *)(data + blocks[b]))->rows;
+}
+
+uint64_t FlightRecordReader::blockFirstStep(int b) const {
+	return ((const BlockHeader *)(data + blocks[b]))->firstStep;
+}
+
+const void * FlightRecordReader::blockColumn(int b, int c) const {
+	uint32_t n = blockRows(b);
+	size_t offset = blocks[b] + sizeof(BlockHeader);
+	for (int i = 0; i < c; i++)
+		offset += align8(n * typeSize(columns[i].type) * columns[i].components);
+	return data + offset;
+}
+
+void FlightRecordReader::readColumn(int c, std::vector<float> &out) const {
+	out.clear();
+	out.reserve(rows * column(c).components);
+	for (int b = 0; b < blockCount(); b++) {
+		int n = blockRows(b) * column(c).components;
+		const void *src = blockColumn(b, c);
+		for (int i = 0; i < n; i++) {
+			switch (column(c).type) {
+			case U8:  out.push_back(((const uint8_t *)src)[i]); break;
+			case U32: out.push_back((float)((const uint32_t *)src)[i]); break;
+			case F32: out.push_back(((const float *)src)[i]); break;
+			}
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "FlightRecord.h"
+
+//  Reads a flight recording written by FlightRecorder.
+//
+//  The file is mapped, not loaded, and blockColumn() points straight into
+//  the mapping.  A recording cut short (the game crashed or was killed)
+//  reads up to its last complete block.  Does not depend on
+//  openFrameworks, so tools can link it on its own.
+//
+class FlightRecordReader {
+public:
+	~FlightRecordReader() { close(); }
+
+	bool open(const std::string &path);
+	void close();
+	const std::string & getError() const { return error; }
+
+	int version() const { return header ? header->version : 0; }
+	float dt() const { return header ? header->dt : 0; }
+
+	int columnCount() const { return header ? (int)header->columnCount : 0; }
+	const flightrec::ColumnDesc & column(int c) const { return columns[c]; }
+	int findColumn(const char *name) const;      // -1 if not recorded
+
+	int blockCount() const { return (int)blocks.size(); }
+	int blockRows(int b) const;
+	uint64_t blockFirstStep(int b) const;
+	uint64_t rowCount() const { return rows; }
+
+	// the values of column c in block b, blockRows(b) * components of them
+	//
+	const void * blockColumn(int b, int c) const;
+
+	// all values of column c converted to float, components interleaved
+	//
+	void readColumn(int c, std::vector<float> &out) const;
+
+private:
+	const uint8_t *data = NULL;
+	size_t size = 0;
+	const flightrec::FileHeader *header = NULL;
+	const flightrec::ColumnDesc *columns = NULL;
+	std::vector<size_t> blocks;            // file offset of each block header
+	uint64_t rows = 0;
+	std::string error;
+
+#ifdef _WIN32
+	void *fileHandle = NULL;
+	void *mapHandle = NULL;
+#endif
+};
@@ -0,0 +1,166 @@
+
+#include "FlightRecorder.h"
+#include <stddef.h>
+#include <string.h>
+#include <iostream>
+
+using namespace flightrec;
+
+// the columns written for a FlightSample, in file order
+//
+struct SampleColumn {
+	const char *name;
+	int type;
+	int components;
+	size_t offset;
+};
+
+static const SampleColumn sampleColumns[] = {
+	{ "step",     U32, 1, offsetof(FlightSample, step) },
+	{ "time",     F32, 1, offsetof(FlightSample, time) },
+	{ "position", F32, 3, offsetof(FlightSample, position) },
+	{ "velocity", F32, 3, offsetof(FlightSample, velocity) },
+	{ "altitude", F32, 1, offsetof(FlightSample, altitude) },
+	{ "thrust",   F32, 3, offsetof(FlightSample, thrust) },
+	{ "impulse",  F32, 3, offsetof(FlightSample, impulse) },
+	{ "target",   F32, 3, offsetof(FlightSample, target) },
+	{ "flags",    U8,  1, offsetof(FlightSample, flags) },
+};
+static const int sampleColumnCount = sizeof(sampleColumns) / sizeof(sampleColumns[0]);
+
+FlightRecorder::FlightRecorder(int rowsPerBlock, int blockCount) {
+	this->rowsPerBlock = rowsPerBlock;
+	this->blockCount = blockCount;
+}
+
+FlightRecorder::~FlightRecorder() {
+	stop();
+}
+
+// open path and write the header, recording starts with the next record()
+//
+bool FlightRecorder::start(const std::string &path, float dt) {
+	stop();
+	file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		std::cout << "FlightRecorder: can't open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = FileMagic;
+	header.version = Version;
+	header.headerSize = sizeof(FileHeader);
+	header.columnCount = sampleColumnCount;
+	header.rowsPerBlock = rowsPerBlock;
+	header.dt = dt;
+	fwrite(&header, sizeof(header), 1, file);
+
+	for (int c = 0; c < sampleColumnCount; c++) {
+		ColumnDesc desc;
+		memset(&desc, 0, sizeof(desc));
+		strncpy(desc.name, sampleColumns[c].name, sizeof(desc.name) - 1);
+		desc.type = sampleColumns[c].type;
+		desc.components = sampleColumns[c].components;
+		fwrite(&desc, sizeof(desc), 1, file);
+	}
+	uint32_t tableEnd = sizeof(FileHeader) + sampleColumnCount * sizeof(ColumnDesc);
+	static const uint8_t zeros[8] = {};
+	fwrite(zeros, align8(tableEnd) - tableEnd, 1, file);
+
+	ring.resize(rowsPerBlock * blockCount);
+	pendingRows.assign(blockCount, 0);
+	freeBlocks.clear();
+	for (int b = blockCount - 1; b > 0; b--) freeBlocks.push_back(b);
+	pending.clear();
+	current = 0;
+	fill = 0;
+	dropped = 0;
+	stopping = false;
+	writer = std::thread(&FlightRecorder::writerLoop, this);
+	return true;
+}
+
+// the last, partial block goes to the writer as it is: nothing is
+// recorded after it, so it needs no free block to follow it and is never
+// dropped
+//
+void FlightRecorder::stop() {
+	if (file == NULL) return;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (fill > 0) {
+			pendingRows[current] = fill;
+			pending.push_back(current);
+			fill = 0;
+		}
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+	fclose(file);
+	file = NULL;
+}
+
+// queue the current block for the writer and move on to a free one
+//
+void FlightRecorder::handOff() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (freeBlocks.empty()) {
+			dropped += fill;
+			fill = 0;
+			return;
+		}
+		pendingRows[current] = fill;
+		pending.push_back(current);
+		current = freeBlocks.back();
+		freeBlocks.pop_back();
+	}
+	fill = 0;
+	wake.notify_one();
+}
+
+void FlightRecorder::writerLoop() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		wake.wait(guard, [this] { return stopping || !pending.empty(); });
+		if (pending.empty()) break;
+		int b = pending.front();
+		pending.pop_front();
+		int rows = pendingRows[b];
+
+		guard.unlock();
+		writeBlock(&ring[b * rowsPerBlock], rows);
+		guard.lock();
+		freeBlocks.push_back(b);
+	}
+	fflush(file);
+}
+
+// transpose rows into one run per column and append them as a block
+//
+void FlightRecorder::writeBlock(const FlightSample *rows, int count) {
+	uint32_t size = 0;
+	for (int c = 0; c < sampleColumnCount; c++)
+		size += align8(count * typeSize(sampleColumns[c].type) * sampleColumns[c].components);
+	columnData.assign(size, 0);
+
+	uint8_t *dst = &columnData[0];
+	for (int c = 0; c < sampleColumnCount; c++) {
+		const SampleColumn &col = sampleColumns[c];
+		int bytes = typeSize(col.type) * col.components;
+		for (int r = 0; r < count; r++) {
+			memcpy(dst + r * bytes, (const uint8_t *)&rows[r] + col.offset, bytes);
+		}
+		dst += align8(count * bytes);
+	}
+
+	BlockHeader header;
+	header.magic = BlockMagic;
+	header.rows = count;
+	header.firstStep = rows[0].step;
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(&columnData[0], size, 1, file);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FlightRecord.h"
+
+//  State of the lander after one simulation step, as it is recorded.
+//  Plain floats so the recorder does not depend on openFrameworks.
+//
+struct FlightSample {
+	uint32_t step;
+	float    time;           // sec of simulated time
+	float    position[3];
+	float    velocity[3];
+	float    altitude;
+	float    thrust[3];      // sum of the thruster forces (per unit mass)
+	float    impulse[3];     // ground impulse applied this step
+	float    target[3];      // autopilot target, valid if TargetSelected is set
+	uint8_t  flags;          // flightrec::Flags
+};
+
+//  Flight data recorder.
+//
+//  record() copies a sample into a ring of fixed size blocks and returns;
+//  it takes a lock only when a block is full (every rowsPerBlock steps).
+//  Full blocks are transposed into columns and written out by a worker
+//  thread.  If the disk falls behind and no block is free the samples of
+//  the current block are dropped and counted, the simulation never waits
+//  on the file.
+//
+class FlightRecorder {
+public:
+	FlightRecorder(int rowsPerBlock = 1024, int blockCount = 4);
+	~FlightRecorder();
+
+	bool start(const std::string &path, float dt);
+	void stop();        // write out what is left and close the file
+	bool isRecording() const { return file != NULL; }
+
+	void record(const FlightSample &s) {
+		if (!file) return;
+		ring[current * rowsPerBlock + fill] = s;
+		if (++fill == rowsPerBlock) handOff();
+	}
+
+	uint64_t getDropped() const { return dropped; }
+
+private:
+	void handOff();
+	void writerLoop();
+	void writeBlock(const FlightSample *rows, int count);
+
+	int rowsPerBlock;
+	int blockCount;
+	std::vector<FlightSample> ring;
+	int current = 0;            // block being filled by record()
+	int fill = 0;               // rows in the current block
+	uint64_t dropped = 0;
+
+	FILE *file = NULL;
+	std::thread writer;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::deque<int> pending;     // full blocks waiting for the writer, in order
+	std::vector<int> freeBlocks;
+	std::vector<int> pendingRows;    // rows in each block
+	bool stopping = false;
+	std::vector<uint8_t> columnData;
+};
@@ -0,0 +1,225 @@
+#include "FrameCapture.h"
+#include "../utils/Profiler.h"
+
+static const int numReadbacks = 3;
+
+FrameCapture::FrameCapture(int encoders, int maxQueued) {
+	if (encoders <= 0) encoders = std::max(1, std::min(4, (int)std::thread::hardware_concurrency() / 2));
+	numEncoders = encoders;
+	this->maxQueued = std::max(1, maxQueued);
+}
+
+FrameCapture::~FrameCapture() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread &t : encoders) t.join();
+}
+
+// the encoders and GL buffers are only set up by the first capture
+//
+void FrameCapture::start() {
+	started = true;
+#ifndef TARGET_OPENGLES
+	usePbo = ofGLCheckExtension("GL_ARB_pixel_buffer_object") && ofGLCheckExtension("GL_ARB_sync");
+#else
+	usePbo = false;
+#endif
+	if (usePbo) {
+		readbacks.resize(numReadbacks);
+		for (Readback &r : readbacks) glGenBuffers(1, &r.buffer);
+	}
+	slots.resize(maxQueued);
+	for (Slot &slot : slots) allocate(slot, ofGetWidth(), ofGetHeight());
+	for (int s = maxQueued - 1; s >= 0; s--) freeSlots.push_back(s);
+	for (int i = 0; i < numEncoders; i++) encoders.push_back(std::thread(&FrameCapture::encoderLoop, this));
+}
+
+void FrameCapture::screenshot(const string &path) {
+	pendingShot = ofToDataPath(path);
+}
+
+bool FrameCapture::startSequence(const string &dir, const string &extension) {
+	stopSequence();
+	sequenceDir = ofToDataPath(dir);
+	if (!ofDirectory::createDirectory(sequenceDir, false, true)) {
+		cout << "FrameCapture: can't create " << sequenceDir << endl;
+		return false;
+	}
+	sequenceExtension = extension;
+	frames = 0;
+	dropped = 0;
+	recording = true;
+	return true;
+}
+
+void FrameCapture::stopSequence() {
+	if (!recording) return;
+	recording = false;
+	cout << "captured " << frames << " frames to " << sequenceDir << " (" << dropped << " dropped)" << endl;
+}
+
+void FrameCapture::capture() {
+	PROFILE_ZONE("FrameCapture::capture");
+
+	// hand on the readbacks the GPU is done with
+	//
+	for (Readback &r : readbacks) {
+		if (!r.fence) continue;
+		GLenum result = glClientWaitSync(r.fence, 0, 0);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) collect(r);
+	}
+
+	if (!pendingShot.empty()) {
+		if (!read(pendingShot)) cout << "FrameCapture: encoders busy, screenshot " << pendingShot << " dropped" << endl;
+		pendingShot.clear();
+	}
+
+	// a frame is only numbered once it has a slot, a dropped frame leaves
+	// no gap in the sequence
+	//
+	if (recording) {
+		if (read(sequenceDir + "/frame-" + ofToString(frames, 5, '0') + "." + sequenceExtension)) frames++;
+		else dropped++;
+	}
+}
+
+// start reading the window back into the next buffer of the ring, or
+// read it straight into a slot without buffers.  False if no slot is
+// free, the frame is not read then.
+//
+bool FrameCapture::read(const string &path) {
+	if (!started) start();
+	int w = ofGetWidth();
+	int h = ofGetHeight();
+
+	// the oldest readback is three frames old by now, waiting for it
+	// costs next to nothing
+	//
+	Readback *r = nullptr;
+	if (usePbo) {
+		r = &readbacks[next];
+		if (r->fence) collect(*r);
+	}
+
+	int s = takeSlot();
+	if (s < 0) return false;
+	Slot &slot = slots[s];
+	if (slot.pixels.getWidth() != w || slot.pixels.getHeight() != h) allocate(slot, w, h);     // window resized
+	slot.path = path;
+
+	if (!usePbo) {
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, slot.pixels.getData());
+		queue(s);
+		return true;
+	}
+	next = (next + 1) % numReadbacks;
+
+	size_t bytes = (size_t)w * h * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, r->buffer);
+	if (bytes > r->capacity) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+		r->capacity = bytes;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	r->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	r->slot = s;
+	return true;
+}
+
+// copy a finished readback into its slot for the encoders
+//
+void FrameCapture::collect(Readback &r) {
+	while (glClientWaitSync(r.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+	glDeleteSync(r.fence);
+	r.fence = 0;
+
+	Slot &slot = slots[r.slot];
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, r.buffer);
+	const void *src = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (src) memcpy(slot.pixels.getData(), src, (size_t)slot.pixels.getWidth() * slot.pixels.getHeight() * 4);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	queue(r.slot);
+}
+
+// the readback and the image a frame of the window size goes through,
+// so nothing is allocated per frame
+//
+void FrameCapture::allocate(Slot &slot, int w, int h) {
+	slot.pixels.allocate(w, h, OF_PIXELS_RGBA);
+	slot.image.allocate(w, h, OF_PIXELS_RGB);
+}
+
+// a free slot, or -1 if the encoders have all of them
+//
+int FrameCapture::takeSlot() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (freeSlots.empty()) return -1;
+	int s = freeSlots.back();
+	freeSlots.pop_back();
+	return s;
+}
+
+void FrameCapture::queue(int s) {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending.push_back(s);
+	}
+	wake.notify_one();
+}
+
+void FrameCapture::close() {
+	for (Readback &r : readbacks) {
+		if (r.fence) collect(r);
+	}
+	stopSequence();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread &t : encoders) t.join();
+	encoders.clear();
+	for (Readback &r : readbacks) glDeleteBuffers(1, &r.buffer);
+	readbacks.clear();
+}
+
+void FrameCapture::encoderLoop() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		wake.wait(guard, [this] { return stopping || !pending.empty(); });
+		if (pending.empty()) break;
+		int s = pending.front();
+		pending.pop_front();
+
+		// GL rows go bottom up, and the images do not need the alpha:
+		// one pass flips and drops it into the slot's image
+		//
+		guard.unlock();
+		Slot &slot = slots[s];
+		int w = (int)slot.pixels.getWidth();
+		int h = (int)slot.pixels.getHeight();
+		const unsigned char *src = slot.pixels.getData();
+		unsigned char *dst = slot.image.getData();
+		for (int y = 0; y < h; y++) {
+			const unsigned char *in = src + (size_t)(h - 1 - y) * w * 4;
+			unsigned char *out = dst + (size_t)y * w * 3;
+			for (int x = 0; x < w; x++) {
+				out[0] = in[0];
+				out[1] = in[1];
+				out[2] = in[2];
+				in += 4;
+				out += 3;
+			}
+		}
+		if (!ofSaveImage(slot.image, slot.path)) cout << "FrameCapture: can't write " << slot.path << endl;
+		guard.lock();
+		freeSlots.push_back(s);
+	}
+}
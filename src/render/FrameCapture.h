@@ -0,0 +1,93 @@
+#pragma once
+
+#include "ofMain.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+//  Screenshots and frame sequences without stalling the frame.
+//
+//  capture() runs at the very end of draw().  It starts a glReadPixels of
+//  the window into the next of a ring of pixel buffer objects and returns
+//  at once: the copy happens on the GPU after the frame is drawn.  A fence
+//  per buffer tells when it is done, usually by the next frame.  The buffer
+//  is then mapped, copied into a free frame slot and handed to the encoder
+//  threads, which flip, PNG-encode and write it.  The render thread never
+//  waits on the encoder or the disk.
+//
+//  The slots are allocated once (maxQueued frames of the window size), so
+//  the memory stays bounded however long a sequence runs.  A frame takes
+//  its slot when it is read back; if the encoders fall behind and none is
+//  free, the frame is dropped and counted instead of piling up, and does
+//  not get a number.
+//
+//  Without pixel buffer objects or sync objects (GLES) the pixels are read
+//  back synchronously, the encoding still runs off the render thread.
+//
+//  A sequence goes to <dir>/frame-00000.png, ... one image per drawn frame,
+//  e.g. for   ffmpeg -framerate 60 -i frame-%05d.png capture.mp4
+//
+class FrameCapture {
+public:
+	FrameCapture(int encoders = 0, int maxQueued = 8);    // 0 encoders = half the cores
+	~FrameCapture();
+
+	// paths are under data/
+	//
+	void screenshot(const string &path);         // of the next frame
+	bool startSequence(const string &dir, const string &extension = "png");
+	void stopSequence();
+	bool isRecording() const { return recording; }
+
+	void capture();      // at the end of draw(), on the main thread
+	void close();        // write out everything in flight, needs the GL context
+
+	// of the current or last sequence: frames written, and frames dropped
+	// because the encoders had every slot
+	//
+	int getFrames() const { return frames; }
+	uint64_t getDropped() const { return dropped; }
+
+private:
+	struct Readback {
+		GLuint buffer = 0;
+		GLsync fence = 0;
+		size_t capacity = 0;
+		int slot = -1;           // the frame is read back for
+	};
+	struct Slot {
+		ofPixels pixels;         // RGBA as read back, bottom row first
+		ofPixels image;          // RGB, top row first, what is encoded
+		string path;
+	};
+
+	void start();
+	bool read(const string &path);
+	void collect(Readback &r);
+	void allocate(Slot &slot, int w, int h);
+	int takeSlot();
+	void queue(int slot);
+	void encoderLoop();
+
+	int numEncoders;
+	int maxQueued;
+	bool usePbo = false;
+	bool started = false;
+	vector<Readback> readbacks;
+	int next = 0;                // readback the next capture goes to
+
+	string pendingShot;
+	bool recording = false;
+	string sequenceDir, sequenceExtension;
+	int frames = 0;
+	uint64_t dropped = 0;
+
+	vector<Slot> slots;
+	vector<std::thread> encoders;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::deque<int> pending;     // slots waiting for an encoder, in order
+	vector<int> freeSlots;
+	bool stopping = false;
+};
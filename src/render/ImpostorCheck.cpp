@@ -0,0 +1,96 @@
+#include "ImpostorCheck.h"
+#include "SphereImpostors.h"
+#include "../particle/ParticleSystem.h"
+
+static const int impostorFrames = 60;
+static const int sphereFrames = 10;       // the old path is slow, fewer frames do
+static const ofColor background(10, 10, 20);
+
+class ImpostorCheckApp : public ofBaseApp {
+public:
+	ImpostorCheckApp(int n) : spheres(n) {}
+
+	void setup() {
+		ofSetVerticalSync(false);
+		ofSetFrameRate(0);
+		ofEnableDepthTest();
+
+		RandomStream rng(1, 0);
+		int side = std::max(1, (int)ceil(cbrt((double)spheres)));
+		for (int i = 0; i < spheres; i++) {
+			Particle p;
+			p.position = ofVec3f(i % side, (i / side) % side, i / (side * side)) - ofVec3f((side - 1) / 2.0f);
+			p.radius = rng.uniform(.2, .6);
+			p.color = ofColor(rng.uniform(64, 255), rng.uniform(64, 255), rng.uniform(64, 255));
+			sys.add(p);
+		}
+		cam.setNearClip(.1);
+		cam.setPosition(side * .9f, side * .7f, side * 1.6f);
+		cam.lookAt(glm::vec3(0, 0, 0));
+	}
+
+	void draw() {
+		ofBackground(background);
+		bool impostors = frame < impostorFrames;
+
+		uint64_t begin = ofGetElapsedTimeMicros();
+		cam.begin();
+		if (impostors) sys.draw();
+		else {
+			for (Particle &p : sys.particles) p.draw();
+		}
+		cam.end();
+		glFinish();
+		double ms = (ofGetElapsedTimeMicros() - begin) / 1000.0;
+
+		// the first frame of each path builds its GL objects, not timed
+		//
+		if (frame != 0 && frame != impostorFrames) (impostors ? impostorMs : sphereMs) += ms;
+		if (frame == impostorFrames - 1) checkFrame();
+		if (++frame == impostorFrames + sphereFrames) finish();
+	}
+
+	// fraction of the frame the impostors cover, they fill a good part of
+	// it from this camera
+	//
+	void checkFrame() {
+		int w = ofGetWidth(), h = ofGetHeight();
+		vector<unsigned char> pixels(w * h * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+		int hit = 0;
+		for (int i = 0; i < w * h; i++) {
+			const unsigned char *p = &pixels[i * 4];
+			if (p[0] != background.r || p[1] != background.g || p[2] != background.b) hit++;
+		}
+		covered = (float)hit / (w * h);
+
+		ofImage image;
+		image.grabScreen(0, 0, w, h);
+		image.save("impostor-check.png");
+	}
+
+	void finish() {
+		SphereImpostors::Path path = SphereImpostors::shared().getPath();
+		cout << (const char *)glGetString(GL_RENDERER) << ", " << (const char *)glGetString(GL_VERSION) << endl;
+		cout << spheres << " spheres, impostor path: " << SphereImpostors::pathName(path) << endl;
+		printf("  impostors      %8.2f ms/frame\n", impostorMs / (impostorFrames - 1));
+		printf("  ofDrawSphere   %8.2f ms/frame\n", sphereMs / (sphereFrames - 1));
+		printf("  covered        %8.1f%% of the frame, saved to impostor-check.png\n", covered * 100);
+		bool ok = path != SphereImpostors::Spheres && covered > .05f;
+		cout << (ok ? "ok" : "FAILED") << endl;
+		ofExit(ok ? 0 : 1);
+	}
+
+	int spheres;
+	ParticleSystem sys;
+	ofCamera cam;
+	int frame = 0;
+	double impostorMs = 0, sphereMs = 0;
+	float covered = 0;
+};
+
+int runImpostorCheck(int spheres) {
+	ofSetupOpenGL(1024, 768, OF_WINDOW);
+	return ofRunApp(new ImpostorCheckApp(std::max(spheres, 1)));
+}
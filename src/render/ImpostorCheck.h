@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Draw a cube of randomly sized and colored particles through
+//  ParticleSystem::draw() and then the same cube one ofDrawSphere() per
+//  particle, report which path SphereImpostors took and the time per frame
+//  of both, and save the impostor frame to data/impostor-check.png.
+//  Fails if the impostors left the frame empty.  Meant to be run on any
+//  driver, Mesa's software one included:
+//
+//      LIBGL_ALWAYS_SOFTWARE=1 space_lander_ver3 --impostor-check [spheres]
+//
+//  Returns the exit code for main().
+//
+int runImpostorCheck(int spheres);
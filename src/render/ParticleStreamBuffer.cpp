@@ -0,0 +1,148 @@
+#include "ParticleStreamBuffer.h"
+
+ParticleStreamBuffer::ParticleStreamBuffer(int regions, bool allowMapping) {
+	numRegions = regions < 1 ? 1 : regions;
+	this->allowMapping = allowMapping;
+}
+
+ParticleStreamBuffer::~ParticleStreamBuffer() {
+	release();
+}
+
+void ParticleStreamBuffer::release() {
+#ifndef TARGET_OPENGLES
+	for (int i = 0; i < fences.size(); i++) {
+		if (fences[i]) glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+#endif
+	if (buffer) glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	capacity = 0;
+}
+
+// (re)create the GL buffer for "capacity" vertices per region
+//
+void ParticleStreamBuffer::allocate(int cap) {
+	release();
+
+#ifndef TARGET_OPENGLES
+	useMapping = allowMapping && ofGLCheckExtension("GL_ARB_map_buffer_range") && ofGLCheckExtension("GL_ARB_sync");
+	if (!useMapping) numRegions = 1;   // glBufferSubData is synchronized by the driver
+	fences.assign(numRegions, (GLsync)0);
+#else
+	useMapping = false;
+	numRegions = 1;
+#endif
+
+	capacity = cap;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity * numRegions * sizeof(ofVec3f), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// block until the GPU has finished the draw that last read region r.
+// With three regions this almost never actually waits.
+//
+void ParticleStreamBuffer::waitForRegion(int r) {
+#ifndef TARGET_OPENGLES
+	if (!fences[r]) return;
+	while (true) {
+		GLenum result = glClientWaitSync(fences[r], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		if (result != GL_TIMEOUT_EXPIRED) break;
+	}
+	glDeleteSync(fences[r]);
+	fences[r] = 0;
+#endif
+}
+
+void ParticleStreamBuffer::upload(const vector<Particle> &particles) {
+	ofVec3f *dst = beginWrite((int)particles.size());
+	if (!dst) return;
+	for (int i = 0; i < count; i++) {
+		dst[i] = particles[i].position;
+	}
+	endWrite(dst);
+}
+
+// positions that are already contiguous (CompactParticleSystem) are
+// copied in one go
+//
+void ParticleStreamBuffer::upload(const vector<ofVec3f> &positions) {
+	ofVec3f *dst = beginWrite((int)positions.size());
+	if (!dst) return;
+	memcpy(dst, &positions[0], count * sizeof(ofVec3f));
+	endWrite(dst);
+}
+
+// return where to write n positions:  the mapped next region of the
+// buffer, or the scratch array if mapping is not available
+//
+ofVec3f * ParticleStreamBuffer::beginWrite(int n) {
+	count = n;
+	if (count == 0) return NULL;
+
+	if (count > capacity) {
+		int cap = capacity > 0 ? capacity : 1024;
+		while (cap < count) cap *= 2;
+		allocate(cap);
+	}
+
+	region = (region + 1) % numRegions;
+	GLintptr offset = (GLintptr)region * capacity * sizeof(ofVec3f);
+	GLsizeiptr size = (GLsizeiptr)count * sizeof(ofVec3f);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	ofVec3f *dst = NULL;
+#ifndef TARGET_OPENGLES
+	if (useMapping) {
+		waitForRegion(region);
+		dst = (ofVec3f *)glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	}
+#endif
+	mapped = dst != NULL;
+	if (!mapped) {
+		scratch.resize(count);
+		dst = &scratch[0];
+	}
+	return dst;
+}
+
+void ParticleStreamBuffer::endWrite(ofVec3f *dst) {
+	if (mapped) {
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	else {
+		GLintptr offset = (GLintptr)region * capacity * sizeof(ofVec3f);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, (GLsizeiptr)count * sizeof(ofVec3f), dst);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ParticleStreamBuffer::draw(GLenum mode) {
+	if (count == 0 || !buffer) return;
+
+	GLintptr offset = (GLintptr)region * capacity * sizeof(ofVec3f);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+#ifndef TARGET_OPENGLES
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(ofVec3f), (const void *)offset);
+	glDrawArrays(mode, 0, count);
+	glDisableClientState(GL_VERTEX_ARRAY);
+#else
+	glEnableVertexAttribArray(ofShader::POSITION_ATTRIBUTE);
+	glVertexAttribPointer(ofShader::POSITION_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(ofVec3f), (const void *)offset);
+	glDrawArrays(mode, 0, count);
+	glDisableVertexAttribArray(ofShader::POSITION_ATTRIBUTE);
+#endif
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+#ifndef TARGET_OPENGLES
+	if (useMapping) {
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+#endif
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ofMain.h"
+#include "../particle/Particle.h"
+
+//  Streaming vertex buffer for drawing particles as points.
+//
+//  One GL buffer is allocated once and split into "regions" (three by
+//  default).  Each frame writes the particle positions straight into the
+//  next region through an unsynchronized glMapBufferRange, so the driver
+//  never has to reallocate storage or stall on a buffer the GPU is still
+//  reading; a fence per region makes sure we only overwrite a region once
+//  the draw that used it is done.  Drivers without map_buffer_range or
+//  sync objects, and GLES, fall back to glBufferSubData on the same buffer.
+//
+//  On GLES the positions go to the generic vertex attribute "position"
+//  (ofShader::POSITION_ATTRIBUTE), which the bound shader has to read, see
+//  shaders_gles/shader.vert.  Elsewhere they are the fixed function vertex
+//  array, gl_Vertex in a shader.
+//
+//  The buffer only grows when the particle count exceeds its capacity.
+//
+class ParticleStreamBuffer {
+public:
+	ParticleStreamBuffer(int regions = 3, bool allowMapping = true);
+	~ParticleStreamBuffer();
+
+	void upload(const vector<Particle> &particles);
+	void upload(const vector<ofVec3f> &positions);
+	void draw(GLenum mode = GL_POINTS);
+	int getCount() const { return count; }
+	bool isMapping() const { return useMapping; }    // known after the first upload
+
+private:
+	void allocate(int capacity);
+	void release();
+	void waitForRegion(int r);
+	ofVec3f * beginWrite(int n);
+	void endWrite(ofVec3f *dst);
+
+	GLuint buffer = 0;
+	int numRegions;
+	int capacity = 0;           // vertices per region
+	int region = 0;             // region written by the last upload
+	int count = 0;              // vertices in that region
+#ifndef TARGET_OPENGLES
+	vector<GLsync> fences;
+#endif
+	bool allowMapping;
+	bool useMapping = false;
+	bool mapped = false;        // current write goes to the mapped buffer
+	vector<ofVec3f> scratch;    // only used without mapping
+};
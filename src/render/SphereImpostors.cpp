@@ -0,0 +1,218 @@
+#include "SphereImpostors.h"
+
+static_assert(sizeof(SphereImpostors::Instance) == 20, "instances are uploaded as is");
+
+// fixed attribute locations.  The corner is per vertex and takes 0, which
+// must always be an enabled array in a compatibility context.
+//
+enum { cornerAttr = 0, centerAttr = 1, colorAttr = 2 };
+
+#ifndef TARGET_OPENGLES
+static const char *shaderHeader =
+	"#version 120\n"
+	"#define MODELVIEW gl_ModelViewMatrix\n"
+	"#define PROJECTION gl_ProjectionMatrix\n"
+	"#define WRITE_DEPTH(d) gl_FragDepth = d\n";
+#else
+static const char *shaderHeader =
+	"#extension GL_EXT_frag_depth : enable\n"
+	"precision highp float;\n"
+	"uniform mat4 modelViewMatrix;\n"
+	"uniform mat4 projectionMatrix;\n"
+	"#define MODELVIEW modelViewMatrix\n"
+	"#define PROJECTION projectionMatrix\n"
+	"#ifdef GL_EXT_frag_depth\n"
+	"#define WRITE_DEPTH(d) gl_FragDepthEXT = d\n"
+	"#else\n"
+	"#define WRITE_DEPTH(d)\n"
+	"#endif\n";
+#endif
+
+// the quad faces the eye (the view axis in an orthographic projection) and
+// sits one radius in front of the center.  From there a half size of one
+// radius covers the outline of the sphere from any distance outside it.
+//
+static const char *vertexSource = R"(
+attribute vec2 corner;
+attribute vec4 centerRadius;
+attribute vec4 tint;
+
+varying vec3 quadPos;
+varying vec4 sphere;
+varying vec4 color;
+
+void main() {
+	vec3 c = (MODELVIEW * vec4(centerRadius.xyz, 1.0)).xyz;
+	float r = centerRadius.w * length(MODELVIEW[0].xyz);
+	bool ortho = PROJECTION[3][3] == 1.0;
+	vec3 toEye = ortho ? vec3(0.0, 0.0, 1.0) : normalize(-c);
+	vec3 side = normalize(cross(abs(toEye.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), toEye));
+	vec3 up = cross(toEye, side);
+
+	quadPos = c + (toEye + side * corner.x + up * corner.y) * r;
+	sphere = vec4(c, r);
+	color = tint;
+	gl_Position = PROJECTION * vec4(quadPos, 1.0);
+}
+)";
+
+// ray from the eye through the quad against the sphere, all in eye space
+//
+static const char *fragmentSource = R"(
+varying vec3 quadPos;
+varying vec4 sphere;
+varying vec4 color;
+
+void main() {
+	bool ortho = PROJECTION[3][3] == 1.0;
+	vec3 origin = ortho ? quadPos : vec3(0.0);
+	vec3 dir = ortho ? vec3(0.0, 0.0, -1.0) : normalize(quadPos);
+	vec3 oc = origin - sphere.xyz;
+	float b = dot(oc, dir);
+	float h = b * b - dot(oc, oc) + sphere.w * sphere.w;
+	if (h < 0.0) discard;
+
+	vec3 hit = origin + dir * (-b - sqrt(h));
+	vec3 n = (hit - sphere.xyz) / sphere.w;
+	float light = 0.35 + 0.65 * max(dot(n, -dir), 0.0);
+	gl_FragColor = vec4(color.rgb * light, color.a);
+
+	vec4 clip = PROJECTION * vec4(hit, 1.0);
+	WRITE_DEPTH((clip.z / clip.w * gl_DepthRange.diff + gl_DepthRange.near + gl_DepthRange.far) * 0.5);
+}
+)";
+
+SphereImpostors & SphereImpostors::shared() {
+	static SphereImpostors impostors;
+	return impostors;
+}
+
+SphereImpostors::~SphereImpostors() {
+	if (cornerBuffer) glDeleteBuffers(1, &cornerBuffer);
+	if (instanceBuffer) glDeleteBuffers(1, &instanceBuffer);
+}
+
+const char * SphereImpostors::pathName(Path p) {
+	switch (p) {
+	case Instanced: return "instanced";
+	case Expanded: return "expanded quads";
+	case Spheres: return "ofDrawSphere";
+	default: return "not ready";
+	}
+}
+
+// build the shader and the buffers on the first draw, when there is a
+// GL context for sure
+//
+void SphereImpostors::setup() {
+	path = Spheres;
+	string header = shaderHeader;
+	if (!shader.setupShaderFromSource(GL_VERTEX_SHADER, header + vertexSource) ||
+		!shader.setupShaderFromSource(GL_FRAGMENT_SHADER, header + fragmentSource)) {
+		cout << "sphere impostor shader does not compile, drawing spheres" << endl;
+		return;
+	}
+	shader.bindAttribute(cornerAttr, "corner");
+	shader.bindAttribute(centerAttr, "centerRadius");
+	shader.bindAttribute(colorAttr, "tint");
+	if (!shader.linkProgram()) {
+		cout << "sphere impostor shader does not link, drawing spheres" << endl;
+		return;
+	}
+
+	glGenBuffers(1, &instanceBuffer);
+	path = Expanded;
+#ifndef TARGET_OPENGLES
+	if (ofGLCheckExtension("GL_ARB_instanced_arrays") && ofGLCheckExtension("GL_ARB_draw_instanced")) {
+		static const ofVec2f strip[4] = { ofVec2f(-1, -1), ofVec2f(1, -1), ofVec2f(-1, 1), ofVec2f(1, 1) };
+		glGenBuffers(1, &cornerBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(strip), strip, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		path = Instanced;
+	}
+#endif
+}
+
+// a fresh store every frame (orphaning) so the driver never waits for the
+// draw of the last frame to let go of it
+//
+void SphereImpostors::upload(const void *data, size_t bytes) {
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	if (bytes > capacity) {
+		capacity = std::max(bytes, capacity * 2);
+	}
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, data);
+}
+
+// center + radius and color, from the bound buffer
+//
+void SphereImpostors::bindInstance(GLsizei stride, size_t offset) {
+	glEnableVertexAttribArray(centerAttr);
+	glVertexAttribPointer(centerAttr, 4, GL_FLOAT, GL_FALSE, stride,
+		(const void *)(offset + offsetof(Instance, center)));
+	glEnableVertexAttribArray(colorAttr);
+	glVertexAttribPointer(colorAttr, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+		(const void *)(offset + offsetof(Instance, color)));
+}
+
+void SphereImpostors::draw() {
+	int n = (int)instances.size();
+	if (n == 0) return;
+	if (path == NotReady) setup();
+
+	if (path == Spheres) {
+		for (const Instance &s : instances) {
+			ofSetColor(s.color);
+			ofDrawSphere(s.center, s.radius);
+		}
+		return;
+	}
+
+	shader.begin();
+#ifndef TARGET_OPENGLES
+	if (path == Instanced) {
+		upload(&instances[0], n * sizeof(Instance));
+		bindInstance(sizeof(Instance), 0);
+		glVertexAttribDivisorARB(centerAttr, 1);
+		glVertexAttribDivisorARB(colorAttr, 1);
+
+		glBindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+		glEnableVertexAttribArray(cornerAttr);
+		glVertexAttribPointer(cornerAttr, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+		glDrawArraysInstancedARB(GL_TRIANGLE_STRIP, 0, 4, n);
+
+		// divisors are state of the attribute, not of the draw
+		glVertexAttribDivisorARB(centerAttr, 0);
+		glVertexAttribDivisorARB(colorAttr, 0);
+	}
+	else
+#endif
+	{
+		static const ofVec2f quad[6] = {
+			ofVec2f(-1, -1), ofVec2f(1, -1), ofVec2f(1, 1),
+			ofVec2f(-1, -1), ofVec2f(1, 1), ofVec2f(-1, 1),
+		};
+		expanded.resize(n * 6);
+		for (int i = 0; i < n; i++) {
+			for (int k = 0; k < 6; k++) {
+				expanded[i * 6 + k].instance = instances[i];
+				expanded[i * 6 + k].corner = quad[k];
+			}
+		}
+		upload(&expanded[0], expanded.size() * sizeof(Vertex));
+		bindInstance(sizeof(Vertex), offsetof(Vertex, instance));
+		glEnableVertexAttribArray(cornerAttr);
+		glVertexAttribPointer(cornerAttr, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+			(const void *)offsetof(Vertex, corner));
+
+		glDrawArrays(GL_TRIANGLES, 0, n * 6);
+	}
+	glDisableVertexAttribArray(cornerAttr);
+	glDisableVertexAttribArray(centerAttr);
+	glDisableVertexAttribArray(colorAttr);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	shader.end();
+}
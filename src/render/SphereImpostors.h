@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Draws any number of spheres in one draw call, as camera facing impostors.
+//
+//  Every sphere is an instance of one four vertex quad: a static buffer
+//  holds the corners, a streamed buffer the center, radius and color of
+//  each sphere.  The vertex shader turns the quad towards the eye and puts
+//  it just in front of the sphere, where it covers the whole outline.  The
+//  fragment shader casts the view ray against the sphere, discards what
+//  misses, shades what hits and writes the depth of the hit, so spheres cut
+//  into each other and into the terrain like real geometry.
+//
+//  Without ARB_instanced_arrays the quads are expanded to six vertices a
+//  sphere on the CPU, still one draw call.  If the shader does not build
+//  the spheres are drawn one by one with ofDrawSphere() as before.
+//
+//  The shader is GLSL 1.20 and instancing the only extension, so it also
+//  runs on Mesa's software rasterizer:
+//
+//      LIBGL_ALWAYS_SOFTWARE=1 space_lander_ver3 --impostor-check [spheres]
+//
+//  GL context thread only.
+//
+class SphereImpostors {
+public:
+	struct Instance {
+		ofVec3f center;
+		float radius;
+		ofColor color;
+	};
+
+	enum Path { NotReady, Instanced, Expanded, Spheres };
+
+	// the one used by ParticleSystem::draw() and CompactParticleSystem::draw()
+	static SphereImpostors & shared();
+
+	~SphereImpostors();
+
+	void clear() { instances.clear(); }
+	void add(const ofVec3f &center, float radius, const ofColor &color) {
+		instances.push_back({ center, radius, color });
+	}
+	void draw();                    // every sphere added since clear()
+	Path getPath() const { return path; }
+	static const char * pathName(Path p);
+
+	vector<Instance> instances;
+
+private:
+	void setup();
+	void upload(const void *data, size_t bytes);
+	void bindInstance(GLsizei stride, size_t offset);
+
+	struct Vertex {
+		Instance instance;
+		ofVec2f corner;
+	};
+
+	ofShader shader;
+	Path path = NotReady;
+	GLuint cornerBuffer = 0;
+	GLuint instanceBuffer = 0;
+	size_t capacity = 0;            // bytes in instanceBuffer
+	vector<Vertex> expanded;        // only used without instancing
+};
@@ -0,0 +1,124 @@
+#include "StreamCheck.h"
+#include "ParticleStreamBuffer.h"
+
+static const int framesPerPath = 90;
+static const int spacing = 3;            // pixels from one point to the next
+
+#ifdef TARGET_OPENGLES
+// GLES has no fixed function, the points need a shader that reads the
+// attribute the buffer draws from
+//
+static const char *vertexSource = R"(
+uniform mat4 modelViewProjectionMatrix;
+attribute vec4 position;
+void main() {
+	gl_Position = modelViewProjectionMatrix * position;
+	gl_PointSize = 1.0;
+}
+)";
+static const char *fragmentSource = R"(
+precision mediump float;
+void main() {
+	gl_FragColor = vec4(1.0);
+}
+)";
+#endif
+
+class StreamCheckApp : public ofBaseApp {
+public:
+	StreamCheckApp() : mapped(3, true), fallback(3, false) {}
+
+	void setup() {
+		ofSetVerticalSync(false);
+		ofSetFrameRate(0);
+		ofDisableDepthTest();
+		ofDisableAntiAliasing();
+#ifdef TARGET_OPENGLES
+		shader.setupShaderFromSource(GL_VERTEX_SHADER, vertexSource);
+		shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragmentSource);
+		shader.bindDefaults();
+		shader.linkProgram();
+#else
+		glPointSize(1);
+#endif
+	}
+
+	void draw() {
+		bool first = frame < framesPerPath;
+		ParticleStreamBuffer &buffer = first ? mapped : fallback;
+		int f = frame % framesPerPath;
+
+		// from a few points up to the whole window, shifted a pixel each
+		// frame so a stale region shows
+		//
+		int columns = ofGetWidth() / spacing;
+		int most = columns * (ofGetHeight() / spacing);
+		int n = std::max(1, most * (f + 1) / framesPerPath);
+		int shift = f % spacing;
+		positions.resize(n);
+		for (int i = 0; i < n; i++) {
+			positions[i] = ofVec3f((i % columns) * spacing + shift + .5f, (i / columns) * spacing + .5f, 0);
+		}
+
+		ofBackground(0);
+		ofSetColor(255);
+		buffer.upload(positions);
+#ifdef TARGET_OPENGLES
+		shader.begin();
+#endif
+		buffer.draw(GL_POINTS);
+#ifdef TARGET_OPENGLES
+		shader.end();
+#endif
+		if (!checkFrame(n, columns, shift)) wrong[first ? 0 : 1]++;
+		if (++frame == 2 * framesPerPath) finish();
+	}
+
+	// every point lit, nothing else
+	//
+	bool checkFrame(int n, int columns, int shift) {
+		int w = ofGetWidth(), h = ofGetHeight();
+		pixels.resize((size_t)w * h * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+		int lit = 0;
+		for (size_t i = 0; i < pixels.size(); i += 4) {
+			if (pixels[i] > 127) lit++;
+		}
+		if (lit != n) return false;
+
+		// the screen is y down, GL rows bottom up
+		//
+		for (int i = 0; i < n; i++) {
+			int x = (i % columns) * spacing + shift;
+			int y = h - 1 - (i / columns) * spacing;
+			if (pixels[((size_t)y * w + x) * 4] <= 127) return false;
+		}
+		return true;
+	}
+
+	void finish() {
+		cout << (const char *)glGetString(GL_RENDERER) << ", " << (const char *)glGetString(GL_VERSION) << endl;
+		printf("  mapped ring       %d of %d frames wrong%s\n", wrong[0], framesPerPath,
+			mapped.isMapping() ? "" : " (not available, drawn through glBufferSubData)");
+		printf("  glBufferSubData   %d of %d frames wrong\n", wrong[1], framesPerPath);
+		bool ok = wrong[0] == 0 && wrong[1] == 0;
+		cout << (ok ? "ok" : "FAILED") << endl;
+		ofExit(ok ? 0 : 1);
+	}
+
+	ParticleStreamBuffer mapped, fallback;
+#ifdef TARGET_OPENGLES
+	ofShader shader;
+#endif
+	vector<ofVec3f> positions;
+	vector<unsigned char> pixels;
+	int frame = 0;
+	int wrong[2] = { 0, 0 };
+};
+
+int runStreamCheck() {
+	ofSetupOpenGL(640, 480, OF_WINDOW);
+	return ofRunApp(new StreamCheckApp());
+}
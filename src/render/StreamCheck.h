@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Draw a grid of points through ParticleStreamBuffer, first with the
+//  mapped ring of regions and then with the glBufferSubData fallback, a
+//  different count and offset every frame so every region is reused and the
+//  buffer grows on the way.  Each frame is read back and every point checked
+//  for, and nothing else drawn.  Reports which path the driver allowed and
+//  fails on any wrong frame.  Meant to be run on any driver:
+//
+//      LIBGL_ALWAYS_SOFTWARE=1 space_lander_ver3 --stream-check
+//
+//  Returns the exit code for main().
+//
+int runStreamCheck();
@@ -0,0 +1,32 @@
+#include "TerrainRenderer.h"
+
+void TerrainRenderer::setup(const ofMesh &mesh, const TerrainLod &l) {
+	int n = (int)mesh.getNumVertices();
+	vbo.setVertexData(&mesh.getVertices()[0], n, GL_STATIC_DRAW);
+	if ((int)mesh.getNumNormals() == n) vbo.setNormalData(&mesh.getNormals()[0], n, GL_STATIC_DRAW);
+
+	// ofIndexType is only 16 bit on GLES, where the terrain has to stay
+	// under 65536 vertices
+	//
+	vector<ofIndexType> indices(l.indices.begin(), l.indices.end());
+	vbo.setIndexData(&indices[0], (int)indices.size(), GL_STATIC_DRAW);
+	lod = &l;
+}
+
+void TerrainRenderer::draw(const ofCamera &cam, bool wireframe) {
+	if (!lod) return;
+	lod->select(cam.getGlobalPosition(), cam.getFov(), ofGetViewportHeight(), maxPixelError, selected);
+
+#ifndef TARGET_OPENGLES
+	if (wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+#endif
+	triangles = 0;
+	for (int i : selected) {
+		const TerrainLodNode &node = lod->nodes[i];
+		vbo.drawElements(GL_TRIANGLES, node.indexCount, node.firstIndex);
+		triangles += node.indexCount / 3;
+	}
+#ifndef TARGET_OPENGLES
+	if (wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+#endif
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ofMain.h"
+#include "../sim/TerrainLod.h"
+
+//  Draws the terrain through its levels of detail.
+//
+//  One vbo holds the vertices and normals of the source mesh and the
+//  indices of every level of the TerrainLod.  Each frame the chunks that
+//  TerrainLod::select() picks for the camera are drawn as index ranges of
+//  it, so switching levels uploads nothing.
+//
+class TerrainRenderer {
+public:
+	void setup(const ofMesh &mesh, const TerrainLod &lod);
+	bool isReady() const { return lod != nullptr; }
+
+	void draw(const ofCamera &cam, bool wireframe);
+
+	float maxPixelError = 1.5;     // on screen, for the chunk errors
+	int getChunks() const { return (int)selected.size(); }
+	int getTriangles() const { return triangles; }    // in the last draw()
+
+private:
+	ofVbo vbo;
+	const TerrainLod *lod = nullptr;
+	vector<int> selected;
+	int triangles = 0;
+};
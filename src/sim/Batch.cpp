@@ -0,0 +1,249 @@
+
+#include "Batch.h"
+#include "LanderSim.h"
+#include "MeshCache.h"
+#include "../utils/ThreadPool.h"
+
+// ranges the parameters are drawn from, uniformly
+//
+static const ofVec2f thrusterRange(2, 8);
+static const ofVec2f autoPilotRange(0.5, 4);
+static const ofVec2f restitutionRange(0, 0.8);
+static const ofVec2f turbulenceRange(0, 1.5);
+static const float targetSpread = 30;     // target within +-30 of the start in x and z
+
+static const float traverseLimit = 60;    // sec to reach the target before descending anyway
+static const float missionLimit = 120;    // sec to touch down
+static const float settleLimit = 10;      // sec after touchdown to come to rest
+static const float softSpeed = 2;         // touchdowns at or below this count as soft
+
+static const uint64_t batchSeed = 1;
+
+// stop hanging and let the lander fall from where it is
+//
+static void release(LanderSim &sim) {
+	sim.hanging = false;
+	sim.b_selectedNode = false;
+	sim.autoPilotForce->set(sim.zeroVec, 0);
+	sim.hangingForce->set(sim.zeroVec, 0);
+}
+
+LanderRun simulateLander(const Octree &terrain, const ofVec3f &start, uint64_t seed, int index,
+	const TerrainLod *broadPhase)
+{
+	RandomStream rng(seed, index);
+	LanderRun run;
+	run.index = index;
+	run.thrusterMag = rng.uniform(thrusterRange.x, thrusterRange.y);
+	run.autoPilotMag = rng.uniform(autoPilotRange.x, autoPilotRange.y);
+	run.restitution = rng.uniform(restitutionRange.x, restitutionRange.y);
+	run.turbulence = rng.uniform(turbulenceRange.x, turbulenceRange.y);
+	ofVec3f offset(rng.uniform(-targetSpread, targetSpread), 0, rng.uniform(-targetSpread, targetSpread));
+	uint64_t simSeed = ((uint64_t)rng.next() << 32) | rng.next();
+
+	LanderSim sim;
+	sim.useBudget = false;
+	sim.thrusterMag = run.thrusterMag;
+	sim.autoPilotMag = run.autoPilotMag;
+	sim.materialRestitution = run.restitution;
+	sim.turbMin = ofVec3f(-run.turbulence);
+	sim.turbMax = ofVec3f(run.turbulence);
+	sim.setup(terrain, start);
+	sim.setSeed(simSeed);
+	sim.setBroadPhase(broadPhase);
+	float dt = sim.simClock.dt;
+
+	// the target is the terrain vertex under start + offset, like a click
+	// on the ground in the game
+	//
+	ofVec3f above = start + offset;
+	Ray down(Vector3(above.x, above.y, above.z), Vector3(0, -1, 0));
+	TreeNode node;
+	if (terrain.intersect(down, terrain.root, node)) {
+		sim.selectedVertex = terrain.mesh.getVertex(node.points[0]);
+		sim.b_selectedNode = true;
+		sim.hanging = true;
+	}
+
+	enum { Traverse, Descend, Settle } phase = sim.hanging ? Traverse : Descend;
+	int maxSteps = (int)((missionLimit + settleLimit) / dt);
+	for (int i = 0; i < maxSteps; i++) {
+		float t = i * dt;
+
+		if (phase == Traverse) {
+			ofVec3f d = sim.selectedVertex - sim.core->position;
+			if (ofVec2f(d.x, d.z).length() <= 2) {
+				run.reachedTarget = true;
+				run.traverseTime = t;
+			}
+			if (run.reachedTarget || t >= traverseLimit) {
+				release(sim);
+				phase = Descend;
+			}
+		}
+
+		// bang-bang pilot: keep the sink rate under a limit that shrinks
+		// towards the ground
+		//
+		if (phase == Descend) {
+			if (t >= missionLimit) break;
+			float limit = ofClamp(0.3f * sim.altitude, 0.5f, 6.0f);
+			if (sim.core->velocity.y < -limit) sim.fireThruster(ofVec3f(0, 1, 0));
+			else sim.cutThruster();
+		}
+
+		ofVec3f velocity = sim.core->velocity;
+		bool touching = sim.groundTouched;
+		sim.step(dt);
+
+		ofVec3f thrust = sim.thrusterForce->getForce() + sim.hangingForce->getForce() +
+			sim.autoPilotForce->getForce();
+		run.fuel += thrust.length() * dt;
+
+		if (sim.groundTouched && !touching) {
+			if (run.landed) run.bounces++;
+			else {
+				run.landed = true;
+				run.touchdownSpeed = velocity.length();
+				run.landingTime = t + dt;
+				if (phase == Traverse) release(sim);
+				sim.cutThruster();
+				phase = Settle;
+			}
+		}
+		if (phase == Settle && (sim.completeStopped || t + dt >= run.landingTime + settleLimit)) {
+			run.settled = sim.completeStopped;
+			break;
+		}
+	}
+	return run;
+}
+
+struct Summary {
+	float mean = 0, p50 = 0, p95 = 0, max = 0;
+};
+
+static Summary summarize(vector<float> v) {
+	Summary s;
+	if (v.empty()) return s;
+	std::sort(v.begin(), v.end());
+	float sum = 0;
+	for (float x : v) sum += x;
+	s.mean = sum / v.size();
+	s.p50 = v[v.size() / 2];
+	s.p95 = v[std::min(v.size() - 1, (size_t)(v.size() * 0.95f))];
+	s.max = v.back();
+	return s;
+}
+
+static void printSummary(const char *name, const vector<float> &v) {
+	Summary s = summarize(v);
+	printf("  %-18s mean %7.2f   p50 %7.2f   p95 %7.2f   max %7.2f\n", name, s.mean, s.p50, s.p95, s.max);
+}
+
+// soft landing rate and mean fuel over four equal bins of one parameter
+//
+static void printBins(const char *name, const vector<LanderRun> &runs, const ofVec2f &range,
+	float LanderRun::*param)
+{
+	const int bins = 4;
+	int count[bins] = {}, soft[bins] = {};
+	float fuel[bins] = {};
+	for (const LanderRun &r : runs) {
+		int b = ofClamp((int)((r.*param - range.x) / (range.y - range.x) * bins), 0, bins - 1);
+		count[b]++;
+		soft[b] += r.landed && r.touchdownSpeed <= softSpeed;
+		fuel[b] += r.fuel;
+	}
+	printf("  %s\n", name);
+	for (int b = 0; b < bins; b++) {
+		float lo = range.x + (range.y - range.x) * b / bins;
+		float hi = range.x + (range.y - range.x) * (b + 1) / bins;
+		int n = std::max(count[b], 1);
+		printf("    %5.2f - %5.2f   runs %6d   soft %5.1f%%   fuel %7.2f\n",
+			lo, hi, count[b], 100.0f * soft[b] / n, fuel[b] / n);
+	}
+}
+
+static bool writeCsv(const string &path, const vector<LanderRun> &runs) {
+	FILE *f = fopen(path.c_str(), "w");
+	if (!f) {
+		cout << "can't write " << path << endl;
+		return false;
+	}
+	fprintf(f, "run,thrusterMag,autoPilotMag,restitution,turbulence,reachedTarget,traverseTime,"
+		"landed,touchdownSpeed,landingTime,bounces,settled,fuel\n");
+	for (const LanderRun &r : runs) {
+		fprintf(f, "%d,%g,%g,%g,%g,%d,%g,%d,%g,%g,%d,%d,%g\n", r.index, r.thrusterMag, r.autoPilotMag,
+			r.restitution, r.turbulence, r.reachedTarget, r.traverseTime, r.landed, r.touchdownSpeed,
+			r.landingTime, r.bounces, r.settled, r.fuel);
+	}
+	fclose(f);
+	return true;
+}
+
+int runBatch(int runs, const string &csvPath) {
+	if (runs <= 0) return 1;
+	ofMesh mesh;
+	if (!loadMeshCached("geo/moon-houdini.obj", mesh)) return 1;
+
+	// one octree for every lander, they only read it
+	//
+	Octree terrain;
+	terrain.create(mesh, 8);
+
+	// and the broad phase of their ground queries, the results are the
+	// same without it
+	//
+	TerrainLod lod;
+	const TerrainLod *broadPhase = nullptr;
+	if (lod.load("geo/moon-houdini.obj", mesh)) {
+		lod.setBroadPhase(1, terrain.leafDiagonalXZ);
+		broadPhase = &lod;
+	}
+
+	// same start as the lander model in ofApp
+	//
+	ofVec3f start(-110, 35, 0);
+
+	vector<LanderRun> results(runs);
+	uint64_t begin = ofGetElapsedTimeMicros();
+	ThreadPool::shared().parallelFor(runs, 1, [&](int first, int last) {
+		for (int i = first; i < last; i++) results[i] = simulateLander(terrain, start, batchSeed, i, broadPhase);
+	});
+	double seconds = (ofGetElapsedTimeMicros() - begin) / 1.0e6;
+
+	vector<float> speed, landingTime, fuel, traverse;
+	int reached = 0, landed = 0, soft = 0, settled = 0;
+	for (const LanderRun &r : results) {
+		fuel.push_back(r.fuel);
+		if (r.reachedTarget) {
+			reached++;
+			traverse.push_back(r.traverseTime);
+		}
+		if (r.landed) {
+			landed++;
+			speed.push_back(r.touchdownSpeed);
+			landingTime.push_back(r.landingTime);
+			if (r.touchdownSpeed <= softSpeed) soft++;
+		}
+		if (r.settled) settled++;
+	}
+
+	cout << runs << " landers in " << seconds << " sec on " << ThreadPool::shared().size() << " threads" << endl;
+	printf("  reached target     %6d  (%.1f%%)\n", reached, 100.0f * reached / runs);
+	printf("  landed             %6d  (%.1f%%)\n", landed, 100.0f * landed / runs);
+	printf("  soft (<= %.1f)      %6d  (%.1f%%)\n", softSpeed, soft, 100.0f * soft / runs);
+	printf("  settled            %6d  (%.1f%%)\n", settled, 100.0f * settled / runs);
+	printSummary("touchdown speed", speed);
+	printSummary("landing time", landingTime);
+	printSummary("traverse time", traverse);
+	printSummary("fuel", fuel);
+	printBins("thrusterMag", results, thrusterRange, &LanderRun::thrusterMag);
+	printBins("autoPilotMag", results, autoPilotRange, &LanderRun::autoPilotMag);
+	printBins("materialRestitution", results, restitutionRange, &LanderRun::restitution);
+	printBins("turbulence", results, turbulenceRange, &LanderRun::turbulence);
+
+	if (!csvPath.empty() && writeCsv(csvPath, results)) cout << "runs written to " << csvPath << endl;
+	return 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ofMain.h"
+#include "../octree/Octree.h"
+#include "TerrainLod.h"
+
+//  Monte-Carlo batch of landers for tuning the ship constants.
+//
+//  Every run draws its own thrusterMag, autoPilotMag, materialRestitution
+//  and turbulence from fixed ranges, and its own target, from a random
+//  stream keyed on (seed, run).  It then flies a scripted mission: hang
+//  and let the autopilot carry the lander over the target, then descend
+//  holding the sink rate down, then touch down and settle.  The runs share
+//  one read only terrain octree and are spread over the thread pool.  The
+//  results only depend on the seed and never on the number of threads.
+//  Started with
+//
+//      space_lander_ver3 --batch [runs] [file.csv]
+//
+struct LanderRun {
+	int index = 0;
+
+	// parameters drawn for this run
+	//
+	float thrusterMag = 0;
+	float autoPilotMag = 0;
+	float restitution = 0;
+	float turbulence = 0;       // half width of the turbulence range
+
+	// outcome
+	//
+	bool reachedTarget = false;
+	float traverseTime = 0;     // sec hanging until over the target
+	bool landed = false;        // touched down within the time limit
+	float touchdownSpeed = 0;   // at the first ground contact
+	float landingTime = 0;      // sec from start to the first contact
+	int bounces = 0;            // ground contacts after the first
+	bool settled = false;       // came to rest on the ground
+	float fuel = 0;             // thrust integrated over time, the delta-v spent
+};
+
+// broadPhase (optional) is handed to LanderSim::setBroadPhase()
+//
+LanderRun simulateLander(const Octree &terrain, const ofVec3f &start, uint64_t seed, int index,
+	const TerrainLod *broadPhase = nullptr);
+
+// returns the exit code for main()
+//
+int runBatch(int runs, const string &csvPath);
@@ -0,0 +1,78 @@
+
+#include "Headless.h"
+#include "LanderSim.h"
+#include "MeshCache.h"
+
+int runHeadless(int steps) {
+	ofMesh terrain;
+	if (!loadMeshCached("geo/moon-houdini.obj", terrain)) return 1;
+
+	// same start as the lander model in ofApp
+	//
+	LanderSim sim;
+	sim.setup(terrain, ofVec3f(-110, 35, 0));
+	float dt = sim.simClock.dt;
+
+	// scripted pilot: a 3 sec burn of the main thruster every 10 sec, so
+	// the run goes through flight, exhaust and ground contact
+	//
+	int period = (int)(10 / dt);
+	int burn = (int)(3 / dt);
+	int maxParticles = 0;
+
+	uint64_t start = ofGetElapsedTimeMicros();
+	for (int i = 0; i < steps; i++) {
+		int phase = i % period;
+		if (phase == 0) {
+			sim.fireThruster(ofVec3f(0, 1, 0));
+			sim.startEmitter = true;
+			sim.liftOff();
+		}
+		else if (phase == burn) {
+			sim.startEmitter = false;
+			sim.cutThruster();
+		}
+		sim.step(dt);
+		maxParticles = std::max(maxParticles, sim.particleCount());
+	}
+	double seconds = (ofGetElapsedTimeMicros() - start) / 1.0e6;
+
+	double simSeconds = steps * (double)dt;
+	cout << "steps:           " << steps << " (" << simSeconds << " sec simulated)" << endl;
+	cout << "wall time:       " << seconds << " sec" << endl;
+	cout << "throughput:      " << steps / std::max(seconds, 1e-9) << " steps/sec, "
+		<< simSeconds / std::max(seconds, 1e-9) << "x real time" << endl;
+	cout << "peak particles:  " << maxParticles << endl;
+	cout << "final position:  " << sim.core->position << ", altitude " << sim.altitude << endl;
+	return 0;
+}
+
+int runReplay(const string &inputPath, const string &flightPath) {
+	float logDt;
+	vector<LoggedInput> inputs;
+	unsigned long steps;
+	if (!InputLog::read(ofToDataPath(inputPath), logDt, inputs, steps)) return 1;
+
+	ofMesh terrain;
+	if (!loadMeshCached("geo/moon-houdini.obj", terrain)) return 1;
+	LanderSim sim;
+	sim.setup(terrain, ofVec3f(-110, 35, 0));
+	float dt = sim.simClock.dt;
+	if (logDt != dt) {
+		cout << inputPath << " was logged with dt " << logDt << ", the game runs at " << dt << endl;
+		return 1;
+	}
+	if (!flightPath.empty() && !sim.recorder.start(ofToDataPath(flightPath), dt)) return 1;
+
+	size_t next = 0;
+	for (unsigned long i = 0; i < steps; i++) {
+		while (next < inputs.size() && inputs[next].step <= i) sim.applyInput(inputs[next++].input);
+		sim.step(dt);
+	}
+	sim.recorder.stop();
+
+	cout << "replayed:        " << inputs.size() << " inputs over " << steps << " steps" << endl;
+	cout << "final position:  " << sim.core->position << ", altitude " << sim.altitude << endl;
+	cout << "final velocity:  " << sim.core->velocity << endl;
+	return 0;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Run the game without a window: load the terrain, fly the lander with a
+//  fixed pattern of burns for the given number of steps as fast as the
+//  machine allows, and print the throughput.  Started with
+//
+//      space_lander_ver3 --headless [steps]
+//
+//  Returns the exit code for main().
+//
+int runHeadless(int steps);
+
+//  Replay an input log (see InputLog.h) into a new lander with the same
+//  start as the game, as fast as possible, and print where it ended up.
+//  With flightPath the replay is also recorded, to compare it with the
+//  recording of the game in tools/flightrec.  Started with
+//
+//      space_lander_ver3 --replay flight-<time>.inputs [replay.flr]
+//
+int runReplay(const string &inputPath, const string &flightPath);
@@ -0,0 +1,112 @@
+#include "InputLog.h"
+
+static const char *controlNames[] = { "up", "down", "left", "right" };
+
+bool InputLog::start(const string &path, float dt) {
+	stop(0);
+	file = fopen(path.c_str(), "w");
+	if (file == NULL) {
+		cout << "InputLog: can't open " << path << " for writing" << endl;
+		return false;
+	}
+	fprintf(file, "# space lander inputs, dt %.9g\n", dt);
+	return true;
+}
+
+void InputLog::stop(unsigned long steps) {
+	if (file == NULL) return;
+	fprintf(file, "end %lu\n", steps);
+	fclose(file);
+	file = NULL;
+}
+
+// %.9g gives back the same float when it is read again
+//
+void InputLog::write(unsigned long step, const LanderInput &in) {
+	if (file == NULL) return;
+	switch (in.type) {
+	case LanderInput::Press:
+		fprintf(file, "%lu press %s%s\n", step, controlNames[in.control & 3],
+			(in.modifiers & LanderInput::Ctrl) ? " ctrl" : "");
+		break;
+	case LanderInput::Release:
+		fprintf(file, "%lu release %s\n", step, controlNames[in.control & 3]);
+		break;
+	case LanderInput::ToggleHanging:
+		fprintf(file, "%lu hang\n", step);
+		break;
+	case LanderInput::Target:
+		fprintf(file, "%lu target %.9g %.9g %.9g\n", step, in.target.x, in.target.y, in.target.z);
+		break;
+	case LanderInput::ClearTarget:
+		fprintf(file, "%lu untarget\n", step);
+		break;
+	}
+
+	// inputs are rare, flush each one so the log survives a crash
+	//
+	fflush(file);
+}
+
+bool InputLog::read(const string &path, float &dt, vector<LoggedInput> &inputs, unsigned long &steps) {
+	ifstream in(path);
+	if (!in) {
+		cout << "InputLog: can't open " << path << endl;
+		return false;
+	}
+	inputs.clear();
+	dt = 0;
+	steps = 0;
+	string line;
+	int lineNumber = 0;
+	while (getline(in, line)) {
+		lineNumber++;
+		if (line.empty()) continue;
+		if (line[0] == '#') {
+			size_t at = line.find("dt ");
+			if (at != string::npos) dt = (float)atof(line.c_str() + at + 3);
+			continue;
+		}
+		istringstream words(line);
+		string first, type;
+		words >> first;
+		if (first == "end") {
+			words >> steps;
+			return true;
+		}
+
+		LoggedInput logged;
+		logged.step = strtoul(first.c_str(), NULL, 10);
+		LanderInput &input = logged.input;
+		words >> type;
+		bool ok = true;
+		if (type == "press" || type == "release") {
+			input.type = (type == "press") ? LanderInput::Press : LanderInput::Release;
+			string control, modifier;
+			words >> control >> modifier;
+			int c = 0;
+			while (c < 4 && control != controlNames[c]) c++;
+			ok = c < 4;
+			input.control = (uint8_t)c;
+			input.modifiers = (modifier == "ctrl") ? LanderInput::Ctrl : 0;
+		}
+		else if (type == "hang") input.type = LanderInput::ToggleHanging;
+		else if (type == "target") {
+			input.type = LanderInput::Target;
+			ok = (bool)(words >> input.target.x >> input.target.y >> input.target.z);
+		}
+		else if (type == "untarget") input.type = LanderInput::ClearTarget;
+		else ok = false;
+
+		if (!ok) {
+			cout << "InputLog: " << path << ":" << lineNumber << ": can't read \"" << line << "\"" << endl;
+			return false;
+		}
+		inputs.push_back(logged);
+	}
+
+	// no end line: the game did not exit cleanly, run up to the last input
+	//
+	if (!inputs.empty()) steps = inputs.back().step + 1;
+	return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  One control of the lander as the player works it.  LanderSim applies
+//  it at the start of a simulation step, see LanderSim::queueInput().
+//
+struct LanderInput {
+	enum Type : uint8_t {
+		Press,            // control, with modifiers held
+		Release,          // control
+		ToggleHanging,
+		Target,           // autopilot target at target, only while hanging
+		ClearTarget,
+	};
+	enum Control : uint8_t { Up, Down, Left, Right };
+	enum Modifier : uint8_t { Ctrl = 1 };
+
+	uint8_t type = Press;
+	uint8_t control = Up;
+	uint8_t modifiers = 0;
+	ofVec3f target;
+
+	double time = 0;      // sec of simulated time it falls in, set by queueInput()
+};
+
+//  Inputs a LanderSim applied, with the step they were applied before.
+//
+//  A text file, one input per line after a header, ending with the number
+//  of steps the run took:
+//
+//      # space lander inputs, dt 0.00833333
+//      0 press up
+//      96 release up
+//      240 press down ctrl
+//      511 hang
+//      640 target -12.5 3.25 40.125
+//      ...
+//      end 7200
+//
+//  The step is the number of steps run before the input, so replaying the
+//  inputs into a new LanderSim with the same seed, see runReplay(),
+//  reproduces the run step for step whatever the frame rate was.
+//
+struct LoggedInput {
+	unsigned long step;
+	LanderInput input;
+};
+
+class InputLog {
+public:
+	~InputLog() { stop(0); }
+
+	bool start(const string &path, float dt);
+	void stop(unsigned long steps);       // steps run in all
+	bool isLogging() const { return file != NULL; }
+
+	void write(unsigned long step, const LanderInput &input);
+
+	static bool read(const string &path, float &dt, vector<LoggedInput> &inputs, unsigned long &steps);
+
+private:
+	FILE *file = NULL;
+};
@@ -0,0 +1,386 @@
+
+#include "LanderSim.h"
+#include "../utils/Profiler.h"
+
+LanderSim::~LanderSim() {
+	recorder.stop();
+	if (shipsys) inputLog.stop(shipsys->steps);
+	if (useBudget) {
+		if (shipsys) ParticleBudget::shared().untrack(shipsys);
+		ParticleBudget::shared().untrack(&exhaust);
+	}
+	delete emitter;
+	delete shipsys;
+}
+
+void LanderSim::setup(const ofMesh &terrain, const ofVec3f &start, int levels) {
+	ofLogVerbose("LanderSim") << "creating octree";
+	octree.create(terrain, levels);
+	ofLogVerbose("LanderSim") << "complete creating octree";
+	ground = &octree;
+	setupShip(start);
+}
+
+void LanderSim::setup(const Octree &terrain, const ofVec3f &start) {
+	ground = &terrain;
+	setupShip(start);
+}
+
+void LanderSim::setSeed(uint64_t seed) {
+	shipsys->setSeed(seed);
+	emitter->setSeed(seed + 1);
+	exhaust.setSeed(seed + 2);
+}
+
+bool LanderSim::setBroadPhase(const TerrainLod *lod) {
+	broadPhase = nullptr;
+	if (lod && lod->getBroadPhaseRadius() < ground->leafDiagonalXZ) {
+		cout << "broad phase grid too narrow for the octree, not used" << endl;
+		return false;
+	}
+	broadPhase = lod;
+	return true;
+}
+
+void LanderSim::setupShip(const ofVec3f &start) {
+
+	// Set up ship particle system
+	shipsys = new ShipSystem();
+	Particle ship;
+	ship.lifespan = INFINITY;
+	ship.mass = 1;
+	ship.position = start;
+	shipsys->add(ship);
+	// Since add/push_back creates a copy of the particle, I need to reset what it points to.
+	core = &(shipsys->particles[0]);
+	prevCorePosition = core->position;
+
+	// the forces live inside shipsys, see ShipSystem in LanderSim.h
+	turbulanceForce = &shipsys->force<0>();
+	thrusterForce = &shipsys->force<1>();
+	moonGravity = &shipsys->force<2>();
+	impulseForce = &shipsys->force<3>();     // for stopping the lander
+	supportGravityForce = &shipsys->force<4>();
+	hangingForce = &shipsys->force<5>();
+	autoPilotForce = &shipsys->force<6>();
+	turbulanceForce->set(turbMin, turbMax);
+	moonGravity->set(gravityF);
+
+	// a lander that has come to rest is put to sleep, touching the controls
+	// (any change of its forces) wakes it up again
+	shipsys->setSleep(0.025f, 0.05f, 30);
+
+	// the flame particles all look alike, keep them in the compact format
+	emitter = new ParticleEmitter(&exhaust);
+	emitter->setEmitterType(DiscEmitter);
+	emitter->setOneShot(true);
+	emitter->setGroupSize(50);
+	emitter->particleColor = ofColor::yellow;
+	emitter->particleRadius = 0.02f;
+	emitter->setLifespanRange(ofVec2f(0.1, 0.5));
+	emitter->setRandomLife(true);
+	emitter->setVelocity(ofVec3f(0, 7, 0));
+	exhaustTurbulence.set(ofVec3f(-5, 0, -5), ofVec3f(5, 0, 5));
+	exhaust.addForce(&exhaustTurbulence);
+	exhaust.setThreaded(true);
+
+	// the exhaust is only cosmetic, let it give way first under load
+	emitter->setPriority(0.2);
+	if (useBudget) {
+		ParticleBudget::shared().track(&exhaust);
+		ParticleBudget::shared().track(shipsys);
+	}
+}
+
+// run as many fixed steps as the elapsed wall time asks for, each one
+// after the inputs that fell in it
+//
+int LanderSim::advanceTo(double wallTime) {
+	float frameTime = (wallClock < 0) ? 0 : (float)(wallTime - wallClock);
+	wallClock = wallTime;
+	double stepEnd = simClock.time;
+	int steps = simClock.advance(frameTime);
+	for (int i = 0; i < steps; i++) {
+		stepEnd += simClock.dt;
+		while (!inputs.empty() && inputs.front().time < stepEnd) {
+			applyInput(inputs.front());
+			inputs.pop_front();
+		}
+		step(simClock.dt);
+	}
+	return steps;
+}
+
+int LanderSim::advance(float frameTime) {
+	if (wallClock < 0) wallClock = 0;
+	return advanceTo(wallClock + frameTime);
+}
+
+// what is on screen lags the last step by one step less what is left in
+// the accumulator (see renderPosition()), an input belongs to the step
+// that was drawn when it happened
+//
+void LanderSim::queueInput(const LanderInput &input, double wallTime) {
+	LanderInput in = input;
+	in.time = simClock.time;
+	if (wallClock >= 0) {
+		in.time += simClock.accumulator - simClock.dt + (wallTime - wallClock);
+	}
+	if (!inputs.empty() && in.time < inputs.back().time) in.time = inputs.back().time;
+	inputs.push_back(in);
+}
+
+// what the lander keys of ofApp used to do as the key went down or up
+//
+void LanderSim::applyInput(const LanderInput &in) {
+	inputLog.write(shipsys->steps, in);
+
+	// a lander at rest on the ground is asleep and no contact is checked
+	// while it rests, sideways thrust would slide it a step along the
+	// ground.  Left and Right are ignored then; the forward and back
+	// thrusters lift it off first, so the move is contact checked.
+	//
+	bool free = !completeStopped;
+	bool ctrl = (in.modifiers & LanderInput::Ctrl) != 0;
+	switch (in.type) {
+	case LanderInput::Press:
+		if (ctrl && (in.control == LanderInput::Up || in.control == LanderInput::Down)) {
+			if (!free && hanging) break;
+			fireThruster(ofVec3f(0, 0, in.control == LanderInput::Up ? 1 : -1));
+			if (in.control == LanderInput::Up || !free) liftOff();
+		}
+		else if (in.control == LanderInput::Up) {
+			if (!hanging) {
+				fireThruster(ofVec3f(0, 1, 0));
+				startEmitter = true;
+			}
+			liftOff();
+		}
+		else if (in.control == LanderInput::Down) {
+			if (!groundTouched || !completeStopped) fireThruster(ofVec3f(0, -1, 0));
+		}
+		else if (free) {
+			fireThruster(ofVec3f(in.control == LanderInput::Left ? -1 : 1, 0, 0));
+		}
+		break;
+	case LanderInput::Release:
+		if (in.control == LanderInput::Up) startEmitter = false;
+		cutThruster();
+		break;
+	case LanderInput::ToggleHanging:
+		toggleHanging();
+		break;
+	case LanderInput::Target:
+		if (!hanging) break;
+		selectedVertex = in.target;
+		b_selectedNode = true;
+		break;
+	case LanderInput::ClearTarget:
+		if (hanging) b_selectedNode = false;
+		break;
+	}
+}
+
+ofVec3f LanderSim::renderPosition() const {
+	return prevCorePosition.getInterpolated(core->position, simClock.alpha());
+}
+
+// advance the game by exactly one fixed step of dt seconds
+//
+void LanderSim::step(float dt) {
+	PROFILE_ZONE("LanderSim::step");
+	prevCorePosition = core->position;
+
+	emitter->setPosition(ofVec3f(core->position.x, core->position.y + 0.5f, core->position.z));
+
+	if (startEmitter) {
+		emitter->start();
+	}
+	else {
+		emitter->stop();
+	}
+
+	// a sleeping lander has not moved since it was last checked, skip
+	// the ground queries
+	bool moving = !core->asleep;
+
+	// calculate altitude
+	// might combine collision calculation and altitude calculation to one calculation
+	if (moving) {
+		PROFILE_ZONE("altitude query");
+		Ray ray = Ray(Vector3(core->position.x, core->position.y, core->position.z),
+			Vector3(0, -1, 0)); // since it always points down
+		TreeNode altitudeNode;
+		if (ground->intersect(ray, ground->root, altitudeNode)) {
+			altitude = glm::length(ground->mesh.getVertex(altitudeNode.points[0]) - glm::vec3(core->position));
+
+		}
+	}
+
+	TreeNode intersectedNode;
+	//turbulanceForce->set(zeroVec, zeroVec);
+
+	bool contact = false;
+	if (moving && !completeStopped) {
+		PROFILE_ZONE("collision query");
+		const ofVec3f &p = core->position;
+		if (broadPhase && p.y > broadPhase->ceiling(p.x, p.z) + ground->leafHeight) {
+			skippedQueries++;
+		}
+		else contact = ground->intersect(p, ground->root, intersectedNode);
+	}
+
+	// lander touches the ground
+	if (contact) {
+		groundTouched = true;
+		//cout << "intersected" << endl;
+		glm::vec3 vec = glm::vec3(core->velocity);
+
+		// impulse large enough to cancel the velocity within this one step
+		impulseForce->set((-1.0f / dt) * vec,
+			ground->mesh.getNormal(intersectedNode.points[0]), materialRestitution);
+
+		turbulanceForce->set(zeroVec, zeroVec);
+
+		//supportGravityForce->set(OppositeGravityF);
+	}
+	else if(completeStopped){
+		groundTouched = true;
+	}
+	else {
+		groundTouched = false;
+		// HANGING
+		// thrustforce equals to gravity so that it stays in space.
+		if (hanging) {
+			//bruteforce approach
+			core->velocity.y = 0;
+			hangingForce->set(ofVec3f(0, 1, 0), moonGravityMag);
+			
+			if (b_selectedNode) {
+				
+				//core->reset();
+				ofVec3f toSelected = selectedVertex - core->position;
+				float distanceXZ = ofVec2f(toSelected.x, toSelected.z).length();
+				ofVec3f dir = toSelected.normalize();
+				//cout << distanceXZ << endl;
+				if (distanceXZ >= 0 && distanceXZ <= 2) {
+					core->reset();
+					autoPilotForce->set(zeroVec, 0);
+
+				}
+				else {
+					autoPilotForce->set(ofVec3f(dir.x, 0, dir.z), autoPilotMag);
+				}
+			}
+			else {
+				autoPilotForce->set(zeroVec, 0);
+
+			}
+		}
+		else {
+			hangingForce->set(zeroVec, 0);
+		}
+		
+	}
+
+	// If below a certain altitude it is "touching" the ground.
+	if (groundTouched) {
+		supportGravityForce->set(OppositeGravityF);
+	}
+	else {
+		supportGravityForce->set(zeroVec);
+	}
+
+	// the impulse is used up by this update
+	ofVec3f impulse = impulseForce->applied ? zeroVec : impulseForce->getForce();
+
+	{
+		PROFILE_ZONE("exhaust update");
+		emitter->update(dt);
+	}
+	{
+		PROFILE_ZONE("ship update");
+		shipsys->update(dt);
+	}
+
+	// Since the velocity will always not equal to 0
+	// it is necessary to specify what zero is.
+	//cout << core->velocity << endl;
+	//cout << "groundTouched: " << groundTouched << "   ";
+	//cout << "completeStopped: " << completeStopped << endl;
+
+	if (groundTouched && (core->velocity.y <= 0.025f && core->velocity.y >= -0.025f)) {
+		//cout << "velocity: " << core->velocity.y << endl;
+		core->sleep();
+		
+		completeStopped = true;
+	}
+
+	recordStep(impulse);
+}
+
+// hand the state after this step to the flight recorder
+//
+void LanderSim::recordStep(const ofVec3f &impulse) {
+	if (!recorder.isRecording()) return;
+
+	ofVec3f thrust = thrusterForce->getForce() + hangingForce->getForce() + autoPilotForce->getForce();
+	FlightSample s;
+	s.step = (uint32_t)shipsys->steps;
+	s.time = (float)shipsys->time;
+	for (int k = 0; k < 3; k++) {
+		s.position[k] = core->position[k];
+		s.velocity[k] = core->velocity[k];
+		s.thrust[k] = thrust[k];
+		s.impulse[k] = impulse[k];
+		s.target[k] = selectedVertex[k];
+	}
+	s.altitude = altitude;
+	s.flags = (groundTouched ? flightrec::GroundTouched : 0) |
+		(completeStopped ? flightrec::CompleteStopped : 0) |
+		(hanging ? flightrec::Hanging : 0) |
+		(startEmitter ? flightrec::EmitterOn : 0) |
+		(b_selectedNode ? flightrec::TargetSelected : 0);
+	recorder.record(s);
+}
+
+// a lander at rest stays asleep, the thrust is just dropped
+//
+void LanderSim::cutThruster() {
+	thrusterForce->set(zeroVec, 0);
+	if (completeStopped) thrusterForce->changed = false;
+}
+
+// main thruster pressed: the lander leaves the ground
+//
+void LanderSim::liftOff() {
+	groundTouched = false;
+	completeStopped = false;
+	core->wake();
+}
+
+void LanderSim::toggleHanging() {
+	hanging = !hanging;
+	startEmitter = hanging;
+	b_selectedNode = false;
+	core->reset();
+}
+
+bool LanderSim::findTarget(const Ray &ray, const ofVec3f &eye, ofVec3f &vertex) const {
+	vector<TreeNode> listOfIntersected;
+	if (!ground->intersect(ray, ground->root, listOfIntersected)) return false;
+
+	// For selecting the closest point to the cam.
+	float closest = INT_MAX;
+	unsigned int closestIndex = 0;
+	for (unsigned int i = 0; i < listOfIntersected.size(); i++) {
+		glm::vec3 v = ground->mesh.getVertex(listOfIntersected[i].points[0]);
+		float distance = glm::length(v - glm::vec3(eye));
+		if (closest > distance) {
+			closest = distance;
+			closestIndex = i;
+		}
+	}
+	vertex = ground->mesh.getVertex(listOfIntersected[closestIndex].points[0]);
+	return true;
+}
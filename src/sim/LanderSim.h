@@ -0,0 +1,153 @@
+#pragma once
+
+#include "ofMain.h"
+#include "../utils/ray.h"
+#include "../octree/Octree.h"
+#include "../particle/ParticleSystem.h"
+#include "../particle/StaticParticleSystem.h"
+#include "../particle/ParticleEmitter.h"
+#include "../particle/CompactParticleSystem.h"
+#include "../utils/SimClock.h"
+#include "TerrainLod.h"
+#include "InputLog.h"
+#include "../recorder/FlightRecorder.h"
+
+// the lander's forces, in the order they are applied
+typedef StaticParticleSystem<TurbulenceForce, Thruster, GravityForce, ImpulseForce,
+	GravityForce, Thruster, Thruster> ShipSystem;
+
+//  The game without a window: lander body and forces, ground contact and
+//  altitude against the terrain octree, and the thruster exhaust.
+//
+//  Nothing here draws or reads the clock of the app, so it runs the same
+//  under ofApp (which feeds it frame times and input and draws the
+//  result) and in the headless runner (which just calls step()).
+//
+class LanderSim {
+public:
+	~LanderSim();
+
+	// build the octree over terrain and place the lander at start
+	//
+	void setup(const ofMesh &terrain, const ofVec3f &start, int levels = 8);
+
+	// land on an octree built elsewhere and shared read only with other
+	// landers, e.g. by the batch runner.  It must outlive this LanderSim.
+	//
+	void setup(const Octree &terrain, const ofVec3f &start);
+
+	// seed of the ship and exhaust random streams (turbulence, spawning)
+	//
+	void setSeed(uint64_t seed);
+
+	// optional broad phase for the collision query: the octree is only
+	// asked when the lander is low enough over the terrain for one of its
+	// leaf boxes to reach it (see TerrainLod::ceiling()).  The grid of lod
+	// must be set up for the radius of the leaves, e.g.
+	//
+	//     lod.setBroadPhase(level, sim.ground->leafDiagonalXZ);
+	//
+	// and lod must outlive this LanderSim.  nullptr turns the broad phase
+	// off.  The contacts found are the same either way.
+	//
+	bool setBroadPhase(const TerrainLod *lod);
+
+	// run the fixed steps up to wallTime (sec, on the clock of the input
+	// times), returns how many were run.  The first call only starts the
+	// clock.
+	//
+	int advanceTo(double wallTime);
+
+	// the same for frameTime seconds of wall time after the last advance
+	//
+	int advance(float frameTime);
+	void step(float dt);
+
+	// queue an input that happened at wallTime, on the clock of
+	// advanceTo().  It is applied at the start of the step that was on
+	// screen at that time, the one renderPosition() was interpolating, or
+	// of the next step if that one has already run.  So the response
+	// does not depend on the frame rate, and with an inputLog started the
+	// run can be replayed step for step (see runReplay()).
+	//
+	void queueInput(const LanderInput &input, double wallTime);
+	void applyInput(const LanderInput &input);     // right away
+
+	// lander position between the last two steps, for drawing
+	//
+	ofVec3f renderPosition() const;
+
+	// controls
+	//
+	void fireThruster(const ofVec3f &dir) { thrusterForce->set(dir, thrusterMag); }
+	void cutThruster();
+	void liftOff();
+	void toggleHanging();
+
+	// the terrain vertex hit by ray closest to eye, for a Target input
+	//
+	bool findTarget(const Ray &ray, const ofVec3f &eye, ofVec3f &vertex) const;
+
+	int particleCount() const { return (int)shipsys->particles.size() + exhaust.size(); }
+
+	Octree octree;                  // built by setup(mesh), drawn by ofApp
+	const Octree *ground = nullptr; // what the queries run against
+	SimClock simClock;
+	FlightRecorder recorder;
+	InputLog inputLog;
+
+	// Ship core
+	ShipSystem* shipsys = nullptr;
+	Particle *core = nullptr;
+	ofVec3f prevCorePosition;
+
+	// emitter
+	ParticleEmitter* emitter = nullptr;
+	CompactParticleSystem exhaust;
+	TurbulenceForce exhaustTurbulence;
+	bool startEmitter = false;
+
+	float altitude = 0;
+
+	const TerrainLod *broadPhase = nullptr;
+	unsigned long skippedQueries = 0;
+
+	// register the particle systems with ParticleBudget::shared(); off for
+	// landers run off the main thread
+	bool useBudget = true;
+
+	// some bool for controls
+	// two bool for checking collision
+	bool groundTouched = false;
+	bool completeStopped = false;
+	bool hanging = false;
+
+	// autopilot target, picked on the terrain while hanging
+	bool b_selectedNode = false;
+	ofVec3f selectedVertex;
+
+	// Forces
+	float thrusterMag = 5.0f; // by default
+	float autoPilotMag = 2.0f;
+	float materialRestitution = 0.4f; // by default
+	float moonGravityMag = 1.62f;
+	ofVec3f zeroVec = ofVec3f(0,0,0);
+	ofVec3f turbMin = ofVec3f(-0.7, -0.7, -0.7);
+	ofVec3f turbMax = ofVec3f(0.7, 0.7, 0.7);
+	ofVec3f gravityF = ofVec3f(0, -moonGravityMag, 0);
+	ofVec3f OppositeGravityF = ofVec3f(0, moonGravityMag, 0);
+	TurbulenceForce *turbulanceForce = nullptr;
+	Thruster *thrusterForce = nullptr;
+	GravityForce *moonGravity = nullptr;
+	ImpulseForce *impulseForce = nullptr;
+	GravityForce *supportGravityForce = nullptr; // the support force of the ground
+	Thruster *hangingForce = nullptr;
+	Thruster *autoPilotForce = nullptr;
+
+private:
+	void setupShip(const ofVec3f &start);
+	void recordStep(const ofVec3f &impulse);
+
+	deque<LanderInput> inputs;      // queued, in time order
+	double wallClock = -1;          // wall time of the last advance, -1 before the first
+};
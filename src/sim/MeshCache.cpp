@@ -0,0 +1,168 @@
+
+#include "MeshCache.h"
+#include "ObjLoader.h"
+#include "../utils/MappedFile.h"
+#include <stdio.h>
+
+static const char cacheMagic[4] = { 'S', 'L', 'M', 'C' };
+static const uint32_t cacheVersion = 1;
+
+static_assert(sizeof(MeshCacheHeader) == 72, "MeshCacheHeader layout");
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "vertices are copied as packed floats");
+
+static uint32_t align16(size_t n) { return (uint32_t)((n + 15) & ~(size_t)15); }
+
+static string cachePath(const string &path) {
+	return ofToDataPath(path + ".slmesh");
+}
+
+//  FNV-1a over 8 byte words with an extra shift so the high bytes of
+//  every word reach the low bits too
+//
+uint64_t hashBytes(const uint8_t *data, size_t size) {
+	const uint64_t prime = 1099511628211ull;
+	uint64_t h = 14695981039346656037ull;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t w;
+		memcpy(&w, data + i, 8);
+		h = (h ^ w) * prime;
+		h ^= h >> 29;
+	}
+	for (; i < size; i++) h = (h ^ data[i]) * prime;
+	return h;
+}
+
+bool hashSource(const string &path, uint64_t &hash, uint64_t &size) {
+	MappedFile source;
+	if (!source.open(ofToDataPath(path))) return false;
+	hash = hashBytes(source.data(), source.size());
+	size = source.size();
+	return true;
+}
+
+// copy the mesh out of the cache if it is intact and was made from this
+// very source
+//
+static bool readCache(const string &file, uint64_t hash, uint64_t size, ofMesh &mesh) {
+	MappedFile cache;
+	if (!cache.open(file) || cache.size() < sizeof(MeshCacheHeader)) return false;
+
+	MeshCacheHeader h;
+	memcpy(&h, cache.data(), sizeof(h));
+	if (memcmp(h.magic, cacheMagic, 4) != 0 || h.version != cacheVersion ||
+		h.sourceHash != hash || h.sourceSize != size) return false;
+
+	size_t vertexBytes = (size_t)h.vertexCount * sizeof(glm::vec3);
+	size_t indexBytes = (size_t)h.indexCount * sizeof(uint32_t);
+	if (h.positionsOffset + vertexBytes > cache.size() ||
+		(h.normalsOffset && h.normalsOffset + vertexBytes > cache.size()) ||
+		h.indicesOffset + indexBytes > cache.size()) return false;
+
+	mesh.clear();
+	mesh.addVertices((const glm::vec3 *)(cache.data() + h.positionsOffset), h.vertexCount);
+	if (h.normalsOffset) mesh.addNormals((const glm::vec3 *)(cache.data() + h.normalsOffset), h.vertexCount);
+	const uint32_t *indices = (const uint32_t *)(cache.data() + h.indicesOffset);
+	if (sizeof(ofIndexType) == sizeof(uint32_t)) {
+		mesh.addIndices((const ofIndexType *)indices, h.indexCount);
+	}
+	else {
+		for (uint32_t i = 0; i < h.indexCount; i++) mesh.addIndex((ofIndexType)indices[i]);
+	}
+	return true;
+}
+
+// write to a temporary file first, so a cache is either whole or absent
+//
+static bool writeCache(const string &file, uint64_t hash, uint64_t size, const ofMesh &mesh) {
+	uint32_t vertexCount = (uint32_t)mesh.getNumVertices();
+	uint32_t indexCount = (uint32_t)mesh.getNumIndices();
+	bool hasNormals = mesh.getNumNormals() == vertexCount && vertexCount > 0;
+
+	MeshCacheHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, cacheMagic, 4);
+	h.version = cacheVersion;
+	h.sourceHash = hash;
+	h.sourceSize = size;
+	h.vertexCount = vertexCount;
+	h.indexCount = indexCount;
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		glm::vec3 v = mesh.getVertex(i);
+		for (int k = 0; k < 3; k++) {
+			float c = (&v.x)[k];
+			if (i == 0 || c < h.boundsMin[k]) h.boundsMin[k] = c;
+			if (i == 0 || c > h.boundsMax[k]) h.boundsMax[k] = c;
+		}
+	}
+	size_t vertexBytes = (size_t)vertexCount * sizeof(glm::vec3);
+	h.positionsOffset = align16(sizeof(h));
+	h.normalsOffset = hasNormals ? align16(h.positionsOffset + vertexBytes) : 0;
+	h.indicesOffset = align16((hasNormals ? h.normalsOffset : h.positionsOffset) + vertexBytes);
+
+	vector<uint32_t> indices(indexCount);
+	for (uint32_t i = 0; i < indexCount; i++) indices[i] = mesh.getIndex(i);
+
+	// arrays in file order, each starting on its 16 byte offset
+	//
+	struct Chunk { uint32_t offset; const void *data; size_t bytes; };
+	const vector<glm::vec3> &vertices = mesh.getVertices();
+	const vector<glm::vec3> &normals = mesh.getNormals();
+	Chunk chunks[3] = {
+		{ h.positionsOffset, vertexCount ? &vertices[0] : nullptr, vertexBytes },
+		{ h.normalsOffset, hasNormals ? &normals[0] : nullptr, hasNormals ? vertexBytes : 0 },
+		{ h.indicesOffset, indexCount ? &indices[0] : nullptr, indexCount * sizeof(uint32_t) },
+	};
+
+	string tmp = file + ".tmp";
+	FILE *f = fopen(tmp.c_str(), "wb");
+	if (!f) return false;
+	static const char zeros[16] = {};
+	bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+	size_t offset = sizeof(h);
+	for (const Chunk &c : chunks) {
+		if (!ok || c.bytes == 0) continue;
+		size_t pad = c.offset - offset;
+		ok = fwrite(zeros, 1, pad, f) == pad && fwrite(c.data, 1, c.bytes, f) == c.bytes;
+		offset = c.offset + c.bytes;
+	}
+	ok = (fclose(f) == 0) && ok;
+
+	if (ok) {
+		remove(file.c_str());     // rename() does not replace on Windows
+		ok = rename(tmp.c_str(), file.c_str()) == 0;
+	}
+	if (!ok) remove(tmp.c_str());
+	return ok;
+}
+
+bool loadMeshCached(const string &path, ofMesh &mesh) {
+	uint64_t hash, size;
+	if (!hashSource(path, hash, size)) {
+		cout << "can't open " << path << endl;
+		return false;
+	}
+	string cache = cachePath(path);
+	if (readCache(cache, hash, size, mesh)) return true;
+
+	cout << "no mesh cache for " << path << ", parsing it" << endl;
+	if (!loadObjMesh(path, mesh)) return false;
+	if (!writeCache(cache, hash, size, mesh)) cout << "can't write " << cache << endl;
+	return true;
+}
+
+bool buildMeshCache(const string &path) {
+	uint64_t hash, size;
+	ofMesh mesh;
+	if (!hashSource(path, hash, size) || !loadObjMesh(path, mesh)) {
+		cout << "can't load " << path << endl;
+		return false;
+	}
+	string cache = cachePath(path);
+	if (!writeCache(cache, hash, size, mesh)) {
+		cout << "can't write " << cache << endl;
+		return false;
+	}
+	cout << cache << ": " << mesh.getNumVertices() << " vertices, " << mesh.getNumIndices() << " indices" << endl;
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Binary cache of parsed OBJ meshes.
+//
+//  loadMeshCached() looks for <path>.slmesh next to the OBJ.  If its header
+//  carries the hash of the OBJ as it is now, the mesh is copied straight
+//  out of a memory mapping of the cache.  Otherwise the OBJ is parsed with
+//  loadObjMesh() and the cache is (re)written for the next run.  The key
+//  is the contents of the OBJ and not its date, so a checkout or a copy
+//  does not throw a valid cache away.
+//
+//  Layout, native byte order, every array 16 byte aligned so it can go to
+//  glBufferData as it is:
+//
+//      MeshCacheHeader     magic "SLMC", version, source hash and size,
+//                          counts, bounds, array offsets
+//      positions           vertexCount x 3 float
+//      normals             vertexCount x 3 float (none if normalsOffset is 0)
+//      indices             indexCount x uint32
+//
+//  Caches can also be built ahead of time:
+//
+//      space_lander_ver3 --mesh-cache geo/moon-houdini.obj [more.obj ...]
+//
+struct MeshCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	float boundsMin[3];
+	float boundsMax[3];
+	uint32_t positionsOffset;
+	uint32_t normalsOffset;
+	uint32_t indicesOffset;
+	uint32_t reserved;
+};
+
+uint64_t hashBytes(const uint8_t *data, size_t size);
+bool hashSource(const string &path, uint64_t &hash, uint64_t &size);    // of a file under data/
+
+bool loadMeshCached(const string &path, ofMesh &mesh);
+bool buildMeshCache(const string &path);
@@ -0,0 +1,218 @@
+#include "MeshSimplify.h"
+#include <queue>
+
+// symmetric 4x4 error quadric, the upper triangle row by row
+//
+struct Quadric {
+	double a[10] = {};
+
+	void addPlane(double x, double y, double z, double d, double w) {
+		a[0] += w * x * x; a[1] += w * x * y; a[2] += w * x * z; a[3] += w * x * d;
+		a[4] += w * y * y; a[5] += w * y * z; a[6] += w * y * d;
+		a[7] += w * z * z; a[8] += w * z * d;
+		a[9] += w * d * d;
+	}
+	Quadric & operator+=(const Quadric &q) {
+		for (int i = 0; i < 10; i++) a[i] += q.a[i];
+		return *this;
+	}
+	double error(const ofVec3f &p) const {
+		double x = p.x, y = p.y, z = p.z;
+		return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+			+ a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+			+ a[7] * z * z + 2 * a[8] * z
+			+ a[9];
+	}
+};
+
+// move vertex "from" onto "to".  The stamps are those of the two vertices
+// when the cost was worked out, a collapse whose vertices have changed
+// since is stale.
+//
+struct Collapse {
+	double cost;
+	int from, to;
+	unsigned stampFrom, stampTo;
+	bool operator<(const Collapse &c) const { return cost > c.cost; }   // cheapest on top
+};
+
+// twice the signed area of a triangle seen from above
+//
+static float areaXZ(const ofVec3f &a, const ofVec3f &b, const ofVec3f &c) {
+	return (b.x - a.x) * (c.z - a.z) - (b.z - a.z) * (c.x - a.x);
+}
+
+class Simplifier {
+public:
+	Simplifier(const vector<ofVec3f> &positions, vector<uint32_t> &triangles, const vector<char> &locked);
+	int run(int target);
+
+private:
+	void consider(int a, int b);
+	void neighbors(int v, vector<int> &out) const;
+	bool canCollapse(int u, int v);
+	void collapse(int u, int v);
+
+	vector<uint32_t> &triangles;
+	vector<uint32_t> global;        // local vertex -> index into positions
+	vector<ofVec3f> pos;
+	vector<char> fixed;
+	vector<int> tris;               // three local vertices per triangle
+	vector<char> alive;
+	vector<vector<int>> vertTris;   // triangles around each vertex, dead ones included
+	vector<Quadric> quadrics;
+	vector<unsigned> stamp;
+	vector<char> removed;
+	priority_queue<Collapse> heap;
+	int left;
+	vector<int> nu, nv;             // scratch for canCollapse()
+};
+
+Simplifier::Simplifier(const vector<ofVec3f> &positions, vector<uint32_t> &triangles, const vector<char> &locked) :
+	triangles(triangles)
+{
+	// number the vertices the triangles use from 0
+	//
+	vector<int> local(positions.size(), -1);
+	tris.resize(triangles.size());
+	for (size_t i = 0; i < triangles.size(); i++) {
+		uint32_t v = triangles[i];
+		if (local[v] < 0) {
+			local[v] = (int)global.size();
+			global.push_back(v);
+			pos.push_back(positions[v]);
+			fixed.push_back(locked[v]);
+		}
+		tris[i] = local[v];
+	}
+	int n = (int)global.size();
+	left = (int)triangles.size() / 3;
+	alive.assign(left, 1);
+	vertTris.resize(n);
+	quadrics.resize(n);
+	stamp.assign(n, 0);
+	removed.assign(n, 0);
+
+	// the plane of every triangle goes to its corners, weighted by area
+	//
+	for (int t = 0; t < left; t++) {
+		const int *v = &tris[t * 3];
+		ofVec3f normal = (pos[v[1]] - pos[v[0]]).getCrossed(pos[v[2]] - pos[v[0]]);
+		float len = normal.length();
+		for (int k = 0; k < 3; k++) vertTris[v[k]].push_back(t);
+		if (len <= 0) continue;
+		normal /= len;
+		double d = -normal.dot(pos[v[0]]);
+		for (int k = 0; k < 3; k++) quadrics[v[k]].addPlane(normal.x, normal.y, normal.z, d, len / 2);
+	}
+	for (int t = 0; t < left; t++) {
+		for (int k = 0; k < 3; k++) consider(tris[t * 3 + k], tris[t * 3 + (k + 1) % 3]);
+	}
+}
+
+// queue both ways of collapsing edge a-b
+//
+void Simplifier::consider(int a, int b) {
+	Quadric q = quadrics[a];
+	q += quadrics[b];
+	if (!fixed[a]) heap.push({ q.error(pos[b]), a, b, stamp[a], stamp[b] });
+	if (!fixed[b]) heap.push({ q.error(pos[a]), b, a, stamp[b], stamp[a] });
+}
+
+void Simplifier::neighbors(int v, vector<int> &out) const {
+	out.clear();
+	for (int t : vertTris[v]) {
+		if (!alive[t]) continue;
+		for (int k = 0; k < 3; k++) {
+			int w = tris[t * 3 + k];
+			if (w != v && std::find(out.begin(), out.end(), w) == out.end()) out.push_back(w);
+		}
+	}
+}
+
+bool Simplifier::canCollapse(int u, int v) {
+	int around = 0, shared = 0;
+	for (int t : vertTris[u]) {
+		if (!alive[t]) continue;
+		around++;
+		const int *c = &tris[t * 3];
+		if (c[0] == v || c[1] == v || c[2] == v) shared++;
+	}
+	if (shared == 0) return false;
+
+	// u has to be inside the mesh (as many neighbors as triangles), and
+	// the only neighbors u and v have in common the corners opposite the
+	// edge, or the collapse would fold the mesh onto itself
+	//
+	neighbors(u, nu);
+	if ((int)nu.size() != around) return false;
+	neighbors(v, nv);
+	int common = 0;
+	for (int w : nu) common += std::find(nv.begin(), nv.end(), w) != nv.end();
+	if (common != shared) return false;
+
+	for (int t : vertTris[u]) {
+		if (!alive[t]) continue;
+		const int *c = &tris[t * 3];
+		if (c[0] == v || c[1] == v || c[2] == v) continue;
+		ofVec3f p[3], q[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = pos[c[k]];
+			q[k] = c[k] == u ? pos[v] : p[k];
+		}
+		float before = areaXZ(p[0], p[1], p[2]);
+		float after = areaXZ(q[0], q[1], q[2]);
+		if (before != 0 && !(before * after > 0)) return false;
+	}
+	return true;
+}
+
+void Simplifier::collapse(int u, int v) {
+	for (int t : vertTris[u]) {
+		if (!alive[t]) continue;
+		int *c = &tris[t * 3];
+		if (c[0] == v || c[1] == v || c[2] == v) {
+			alive[t] = 0;
+			left--;
+			continue;
+		}
+		for (int k = 0; k < 3; k++) if (c[k] == u) c[k] = v;
+		vertTris[v].push_back(t);
+	}
+	removed[u] = 1;
+	vertTris[u].clear();
+	quadrics[v] += quadrics[u];
+
+	vector<int> &vt = vertTris[v];
+	vt.erase(std::remove_if(vt.begin(), vt.end(), [this](int t) { return !alive[t]; }), vt.end());
+
+	// every edge of v has a new cost
+	//
+	stamp[v]++;
+	neighbors(v, nv);
+	for (int w : nv) consider(v, w);
+}
+
+int Simplifier::run(int target) {
+	while (left > target && !heap.empty()) {
+		Collapse c = heap.top();
+		heap.pop();
+		if (removed[c.from] || removed[c.to] || stamp[c.from] != c.stampFrom || stamp[c.to] != c.stampTo) continue;
+		if (canCollapse(c.from, c.to)) collapse(c.from, c.to);
+	}
+
+	triangles.clear();
+	for (size_t t = 0; t < alive.size(); t++) {
+		if (!alive[t]) continue;
+		for (int k = 0; k < 3; k++) triangles.push_back(global[tris[t * 3 + k]]);
+	}
+	return left;
+}
+
+int simplifyMesh(const vector<ofVec3f> &positions, vector<uint32_t> &triangles,
+	const vector<char> &locked, int target)
+{
+	if ((int)triangles.size() / 3 <= target) return (int)triangles.size() / 3;
+	Simplifier s(positions, triangles, locked);
+	return s.run(target);
+}
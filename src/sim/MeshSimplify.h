@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Quadric error edge collapse (Garland and Heckbert) for terrain meshes.
+//
+//  triangles holds three indices into positions per triangle.  Edges are
+//  collapsed cheapest first, by the summed squared distance to the planes
+//  of the original triangles around them, until no more than target
+//  triangles are left or no collapse is allowed.  A collapse moves one end
+//  of the edge onto the other (a half edge collapse), so every vertex left
+//  is one of the input vertices and the result indexes the same positions
+//  array as the input.
+//
+//  Collapses are not allowed
+//    - to remove a vertex marked in locked, so borders stay exactly where
+//      they are
+//    - if the mesh would stop being a manifold around the edge
+//    - if a triangle would turn over seen from above (+y), so a height
+//      field stays one
+//
+//  Returns the number of triangles left.
+//
+int simplifyMesh(const vector<ofVec3f> &positions, vector<uint32_t> &triangles,
+	const vector<char> &locked, int target);
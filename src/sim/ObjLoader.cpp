@@ -0,0 +1,96 @@
+
+#include "ObjLoader.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// parse one "v", "v/t", "v//n" or "v/t/n" face corner, 1 based or negative
+// (relative) indices, returns the 0 based vertex and normal (-1 if none)
+//
+static bool parseCorner(const char *&s, int numVerts, int numNormals, int &v, int &n) {
+	char *end;
+	long vi = strtol(s, &end, 10);
+	if (end == s) return false;
+	s = end;
+	v = (vi < 0) ? numVerts + (int)vi : (int)vi - 1;
+	n = -1;
+	if (*s == '/') {
+		s++;
+		if (*s != '/') {       // texture index, unused
+			strtol(s, &end, 10);
+			s = end;
+		}
+		if (*s == '/') {
+			s++;
+			long ni = strtol(s, &end, 10);
+			if (end != s) n = (ni < 0) ? numNormals + (int)ni : (int)ni - 1;
+			s = end;
+		}
+	}
+	return v >= 0 && v < numVerts;
+}
+
+bool loadObjMesh(const string &path, ofMesh &mesh) {
+	FILE *f = fopen(ofToDataPath(path).c_str(), "r");
+	if (f == NULL) {
+		cout << "can't open " << path << endl;
+		return false;
+	}
+
+	vector<glm::vec3> verts, fileNormals, normals;
+	vector<ofIndexType> indices;
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		float x, y, z;
+		if (line[0] == 'v' && line[1] == ' ' && sscanf(line + 2, "%f %f %f", &x, &y, &z) == 3) {
+			verts.push_back(glm::vec3(x, y, z));
+		}
+		else if (line[0] == 'v' && line[1] == 'n' && sscanf(line + 3, "%f %f %f", &x, &y, &z) == 3) {
+			fileNormals.push_back(glm::vec3(x, y, z));
+		}
+		else if (line[0] == 'f' && line[1] == ' ') {
+			if (normals.size() < verts.size()) normals.resize(verts.size(), glm::vec3(0, 0, 0));
+
+			// fan out the polygon, summing the normals into its vertices
+			//
+			const char *s = line + 2;
+			int numVerts = (int)verts.size(), numNormals = (int)fileNormals.size();
+			int corner[64], cornerNormal[64];
+			int n = 0;
+			while (n < 64) {
+				while (*s == ' ' || *s == '\t') s++;
+				if (!parseCorner(s, numVerts, numNormals, corner[n], cornerNormal[n])) break;
+				n++;
+			}
+			for (int i = 2; i < n; i++) {
+				indices.push_back(corner[0]);
+				indices.push_back(corner[i - 1]);
+				indices.push_back(corner[i]);
+				glm::vec3 faceNormal = glm::cross(verts[corner[i - 1]] - verts[corner[0]], verts[corner[i]] - verts[corner[0]]);
+				int tri[3] = { 0, i - 1, i };
+				for (int k = 0; k < 3; k++) {
+					int c = tri[k];
+					bool hasNormal = cornerNormal[c] >= 0 && cornerNormal[c] < numNormals;
+					normals[corner[c]] += hasNormal ? fileNormals[cornerNormal[c]] : faceNormal;
+				}
+			}
+		}
+	}
+	fclose(f);
+
+	if (verts.empty()) {
+		cout << path << " has no vertices" << endl;
+		return false;
+	}
+	normals.resize(verts.size(), glm::vec3(0, 0, 0));
+	for (size_t i = 0; i < normals.size(); i++) {
+		float len = glm::length(normals[i]);
+		normals[i] = (len > 0) ? normals[i] / len : glm::vec3(0, 1, 0);
+	}
+
+	mesh.clear();
+	mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	mesh.addVertices(verts);
+	mesh.addNormals(normals);
+	mesh.addIndices(indices);
+	return true;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Read the vertices, normals and faces of a Wavefront .obj into mesh,
+//  without a GL context (ofxAssimpModelLoader needs one), for the
+//  headless runner.  Polygons are split into triangle fans.  Vertex i of
+//  the mesh is "v" line i of the file; its normal is the average of the
+//  normals its faces give it, or of the face normals if the file has none.
+//
+bool loadObjMesh(const string &path, ofMesh &mesh);
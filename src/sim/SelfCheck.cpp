@@ -0,0 +1,148 @@
+#include "SelfCheck.h"
+#include "../particle/ParticleEmitter.h"
+#include "../particle/ParticleBudget.h"
+#include "../utils/ThreadPool.h"
+#include "../utils/Random.h"
+#include "../recorder/FlightRecorder.h"
+#include "../recorder/FlightRecordReader.h"
+#include <atomic>
+#include <stddef.h>
+
+static bool report(const char *name, bool ok, const string &detail) {
+	printf("%-28s %s  %s\n", name, ok ? "ok    " : "FAILED", detail.c_str());
+	return ok;
+}
+
+// at an emission scale of .5 a group of 1 spawns on every second group
+// fired, whatever number of updates there are between the groups
+//
+static bool checkEmitterCarry() {
+	ParticleEmitter emitter;
+	emitter.setGroupSize(1);
+	emitter.setPriority(0);
+	emitter.setLifespan(1000);
+
+	// pin the budget at a scale of .5
+	//
+	ParticleBudget budget;
+	budget.minScale = 0.5f;
+	budget.setFrameBudget(0.001f);
+	budget.track(emitter.sys);
+	budget.beginFrame();
+	budget.addUpdateCost(1.0e6);
+	budget.endFrame();
+
+	string pattern;
+	bool ok = budget.emissionScale(0) == 0.5f;
+	for (int group = 0; group < 20; group++) {
+		size_t before = emitter.sys->particles.size();
+		emitter.start();
+		emitter.update(0.01f);
+		int spawned = (int)(emitter.sys->particles.size() - before);
+		pattern += ofToString(spawned);
+		ok = ok && spawned == group % 2;
+
+		// stopped updates in between must not use up the carry
+		//
+		for (int i = 0; i < group % 3; i++) emitter.update(0.01f);
+	}
+	budget.untrack(emitter.sys);
+	return report("emitter carry", ok, "groups " + pattern);
+}
+
+// back to back loops on more threads than cores, so workers often wake
+// late: every index of every loop has to be run exactly once
+//
+static bool checkThreadPool() {
+	ThreadPool pool(4 * std::max(2, (int)std::thread::hardware_concurrency()));
+	const int loops = 200000;
+	vector<std::atomic<int>> hits(64);
+	int wrong = 0;
+	for (int loop = 0; loop < loops; loop++) {
+		int count = 2 + loop % 63;
+		for (int i = 0; i < count; i++) hits[i] = 0;
+		pool.parallelFor(count, 1 + loop % 3, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) hits[i]++;
+		});
+		for (int i = 0; i < count; i++) wrong += hits[i] != 1;
+	}
+	return report("thread pool", wrong == 0, ofToString(loops) + " loops on " + ofToString(pool.size()) +
+		" threads, " + ofToString(wrong) + " indices not run once");
+}
+
+// a recorder of one block never has a free one, the partial block left
+// at stop() is written all the same.  The reader then rejects the file
+// with a header size too small and too large for it.
+//
+static bool checkFlightRecorder() {
+	string path = ofToDataPath("self-check.flr");
+	FlightRecorder recorder(16, 1);
+	if (!recorder.start(path, 0.01f)) return report("flight recorder", false, "can't write " + path);
+	FlightSample s;
+	memset(&s, 0, sizeof(s));
+	for (int i = 0; i < 10; i++) {
+		s.step = i;
+		recorder.record(s);
+	}
+	recorder.stop();
+
+	FlightRecordReader reader;
+	uint64_t rows = reader.open(path) ? reader.rowCount() : 0;
+	reader.close();
+
+	int accepted = 0;
+	uint16_t badSizes[] = { 8, 0xFFFF };
+	for (uint16_t headerSize : badSizes) {
+		FILE *f = fopen(path.c_str(), "r+b");
+		if (f == NULL) break;
+		fseek(f, offsetof(flightrec::FileHeader, headerSize), SEEK_SET);
+		fwrite(&headerSize, sizeof(headerSize), 1, f);
+		fclose(f);
+		if (reader.open(path)) accepted++;
+		reader.close();
+	}
+	remove(path.c_str());
+
+	return report("flight recorder", rows == 10 && accepted == 0, ofToString(rows) + " of 10 rows read back, " +
+		ofToString(accepted) + " bad header sizes accepted");
+}
+
+// chunk streams of neighbouring seeds must be unrelated: seed s at step
+// t + 1 once started the same as seed s + 1 at step t.  Counts such
+// repeats and correlates the draws of seeds s and s + 1 at the same step.
+//
+static bool checkChunkStreams() {
+	int repeats = 0;
+	double n = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+	for (uint64_t seed = 1; seed <= 64; seed++) {
+		for (uint64_t step = 0; step < 64; step++) {
+			RandomStream later = RandomStream::forChunk(seed, step + 1, 0);
+			RandomStream next = RandomStream::forChunk(seed + 1, step, 0);
+			if (later.next() == next.next()) repeats++;
+
+			RandomStream a = RandomStream::forChunk(seed, step, 0);
+			RandomStream b = RandomStream::forChunk(seed + 1, step, 0);
+			for (int i = 0; i < 16; i++) {
+				double x = a.uniform(), y = b.uniform();
+				n++;
+				sx += x;
+				sy += y;
+				sxx += x * x;
+				syy += y * y;
+				sxy += x * y;
+			}
+		}
+	}
+	double r = (n * sxy - sx * sy) / sqrt((n * sxx - sx * sx) * (n * syy - sy * sy));
+	return report("chunk streams", repeats == 0 && fabs(r) < .02, ofToString(repeats) +
+		" streams repeated a neighbouring seed, correlation " + ofToString(r, 4));
+}
+
+int runSelfCheck() {
+	bool ok = true;
+	ok = checkEmitterCarry() && ok;
+	ok = checkThreadPool() && ok;
+	ok = checkFlightRecorder() && ok;
+	ok = checkChunkStreams() && ok;
+	return ok ? 0 : 1;
+}
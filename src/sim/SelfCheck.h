@@ -0,0 +1,12 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Checks of the engine code that need no window or data: each one
+//  prints a line with its result.  Started with
+//
+//      space_lander_ver3 --self-check
+//
+//  Returns the exit code for main(), 1 if any check failed.
+//
+int runSelfCheck();
@@ -0,0 +1,413 @@
+
+#include "TerrainLod.h"
+#include "MeshCache.h"
+#include "MeshSimplify.h"
+#include "../utils/MappedFile.h"
+#include <float.h>
+#include <stdio.h>
+#include <unordered_map>
+
+static const char lodMagic[4] = { 'S', 'L', 'L', 'D' };
+static const uint32_t lodVersion = 1;
+
+static const int leafTriangles = 4096;    // the chunks are made about this big
+static const int maxDepth = 6;
+
+static_assert(sizeof(TerrainLodHeader) == 48, "TerrainLodHeader layout");
+static_assert(sizeof(TerrainLodNode) == 56, "TerrainLodNode layout");
+
+static uint32_t align16(size_t n) { return (uint32_t)((n + 15) & ~(size_t)15); }
+
+static string lodPath(const string &path) {
+	return ofToDataPath(path + ".sllod");
+}
+
+// a node of the tree while it is built, level by level from the leaves
+//
+struct LodChunk {
+	vector<uint32_t> tris;
+	vector<uint32_t> under;         // source vertices under it, for the error
+	ofVec3f bmin = ofVec3f(FLT_MAX), bmax = ofVec3f(-FLT_MAX);
+	float error = 0;
+};
+
+// largest vertical distance from a vertex in under to the surface of tris.
+// The triangles are bucketed in a grid over x and z first.
+//
+static float verticalError(const vector<ofVec3f> &v, const LodChunk &c) {
+	int n = (int)c.tris.size() / 3;
+	if (n == 0) return 0;
+	int side = std::max(1, (int)sqrt(n / 2.0));
+	float w = std::max(c.bmax.x - c.bmin.x, 1e-6f) / side;
+	float h = std::max(c.bmax.z - c.bmin.z, 1e-6f) / side;
+	auto cell = [&](float x, float z, int &i, int &j) {
+		i = ofClamp((int)((x - c.bmin.x) / w), 0, side - 1);
+		j = ofClamp((int)((z - c.bmin.z) / h), 0, side - 1);
+	};
+	vector<vector<int>> grid(side * side);
+	for (int t = 0; t < n; t++) {
+		const ofVec3f &a = v[c.tris[t * 3]], &b = v[c.tris[t * 3 + 1]], &d = v[c.tris[t * 3 + 2]];
+		int i0, j0, i1, j1;
+		cell(std::min(a.x, std::min(b.x, d.x)), std::min(a.z, std::min(b.z, d.z)), i0, j0);
+		cell(std::max(a.x, std::max(b.x, d.x)), std::max(a.z, std::max(b.z, d.z)), i1, j1);
+		for (int j = j0; j <= j1; j++) {
+			for (int i = i0; i <= i1; i++) grid[j * side + i].push_back(t);
+		}
+	}
+
+	float error = 0;
+	int missed = 0;
+	for (uint32_t k : c.under) {
+		const ofVec3f &p = v[k];
+		int i, j;
+		cell(p.x, p.z, i, j);
+		bool found = false;
+		for (int t : grid[j * side + i]) {
+			const ofVec3f &a = v[c.tris[t * 3]], &b = v[c.tris[t * 3 + 1]], &d = v[c.tris[t * 3 + 2]];
+			float area = (b.x - a.x) * (d.z - a.z) - (b.z - a.z) * (d.x - a.x);
+			if (area == 0) continue;
+			float u = ((b.x - p.x) * (d.z - p.z) - (b.z - p.z) * (d.x - p.x)) / area;
+			float s = ((d.x - p.x) * (a.z - p.z) - (d.z - p.z) * (a.x - p.x)) / area;
+			float r = 1 - u - s;
+			const float eps = -1e-5f;
+			if (u < eps || s < eps || r < eps) continue;
+			error = std::max(error, fabsf(u * a.y + s * b.y + r * d.y - p.y));
+			found = true;
+			break;
+		}
+		missed += !found;
+	}
+	if (missed) cout << "terrain lod: " << missed << " vertices not under any triangle" << endl;
+	return error;
+}
+
+// the whole tree from the source mesh, nodes root first
+//
+static bool buildLod(const ofMesh &mesh, vector<TerrainLodNode> &nodes, vector<uint32_t> &indices, int &depth) {
+	int vertexCount = (int)mesh.getNumVertices();
+	int triCount = (int)mesh.getNumIndices() / 3;
+	if (triCount == 0) return false;
+	vector<ofVec3f> v(vertexCount);
+	ofVec3f lo(FLT_MAX), hi(-FLT_MAX);
+	for (int i = 0; i < vertexCount; i++) {
+		v[i] = mesh.getVertex(i);
+		lo.set(std::min(lo.x, v[i].x), std::min(lo.y, v[i].y), std::min(lo.z, v[i].z));
+		hi.set(std::max(hi.x, v[i].x), std::max(hi.y, v[i].y), std::max(hi.z, v[i].z));
+	}
+
+	depth = 0;
+	while (depth < maxDepth && (triCount >> (2 * depth)) > leafTriangles) depth++;
+	int side = 1 << depth;
+
+	// leaves: every triangle goes to the chunk its center is over
+	//
+	vector<LodChunk> level(side * side);
+	for (int t = 0; t < triCount; t++) {
+		uint32_t c[3] = { mesh.getIndex(t * 3), mesh.getIndex(t * 3 + 1), mesh.getIndex(t * 3 + 2) };
+		ofVec3f center = (v[c[0]] + v[c[1]] + v[c[2]]) / 3;
+		int i = ofClamp((int)((center.x - lo.x) / std::max(hi.x - lo.x, 1e-6f) * side), 0, side - 1);
+		int j = ofClamp((int)((center.z - lo.z) / std::max(hi.z - lo.z, 1e-6f) * side), 0, side - 1);
+		LodChunk &leaf = level[j * side + i];
+		for (int k = 0; k < 3; k++) {
+			leaf.tris.push_back(c[k]);
+			leaf.bmin.set(std::min(leaf.bmin.x, v[c[k]].x), std::min(leaf.bmin.y, v[c[k]].y), std::min(leaf.bmin.z, v[c[k]].z));
+			leaf.bmax.set(std::max(leaf.bmax.x, v[c[k]].x), std::max(leaf.bmax.y, v[c[k]].y), std::max(leaf.bmax.z, v[c[k]].z));
+		}
+	}
+	for (LodChunk &leaf : level) {
+		leaf.under = leaf.tris;
+		std::sort(leaf.under.begin(), leaf.under.end());
+		leaf.under.erase(std::unique(leaf.under.begin(), leaf.under.end()), leaf.under.end());
+	}
+
+	// the open edges of the source stay put at every level
+	//
+	vector<char> outline(vertexCount, 0);
+	std::unordered_map<uint64_t, int> edges;
+	for (int t = 0; t < triCount; t++) {
+		for (int k = 0; k < 3; k++) {
+			uint64_t a = mesh.getIndex(t * 3 + k), b = mesh.getIndex(t * 3 + (k + 1) % 3);
+			edges[a < b ? (a << 32 | b) : (b << 32 | a)]++;
+		}
+	}
+	for (auto &e : edges) {
+		if (e.second == 1) outline[e.first >> 32] = outline[e.first & 0xffffffff] = 1;
+	}
+
+	// up the tree: four chunks into one, simplified with its outline
+	// locked.  The outline is every vertex shared with another chunk of
+	// the same level.
+	//
+	vector<vector<LodChunk>> levels;
+	levels.push_back(std::move(level));
+	for (int l = 1; l <= depth; l++) {
+		const vector<LodChunk> &below = levels.back();
+		int s = side >> l;
+		vector<LodChunk> up(s * s);
+		vector<int> owner(vertexCount, -1);
+		vector<char> locked = outline;
+		for (int k = 0; k < s * s; k++) {
+			int i = k % s, j = k / s;
+			LodChunk &node = up[k];
+			for (int c = 0; c < 4; c++) {
+				const LodChunk &child = below[(2 * j + c / 2) * (2 * s) + 2 * i + c % 2];
+				node.tris.insert(node.tris.end(), child.tris.begin(), child.tris.end());
+				node.under.insert(node.under.end(), child.under.begin(), child.under.end());
+				node.bmin.set(std::min(node.bmin.x, child.bmin.x), std::min(node.bmin.y, child.bmin.y), std::min(node.bmin.z, child.bmin.z));
+				node.bmax.set(std::max(node.bmax.x, child.bmax.x), std::max(node.bmax.y, child.bmax.y), std::max(node.bmax.z, child.bmax.z));
+				node.error = std::max(node.error, child.error);
+			}
+			for (uint32_t x : node.tris) {
+				if (owner[x] < 0) owner[x] = k;
+				else if (owner[x] != k) locked[x] = 1;
+			}
+		}
+		for (LodChunk &node : up) {
+			simplifyMesh(v, node.tris, locked, (int)node.tris.size() / 3 / 4);
+			node.error = std::max(node.error, verticalError(v, node));
+		}
+		levels.push_back(std::move(up));
+	}
+
+	// flatten, root first and every level after the one above it
+	//
+	nodes.clear();
+	indices.clear();
+	vector<int> first(depth + 2, 0);
+	for (int l = depth; l >= 0; l--) first[depth - l + 1] = first[depth - l] + (int)levels[l].size();
+	for (int l = depth; l >= 0; l--) {
+		int s = side >> l;
+		for (int k = 0; k < s * s; k++) {
+			const LodChunk &c = levels[l][k];
+			TerrainLodNode node;
+			memset(&node, 0, sizeof(node));
+			for (int a = 0; a < 3; a++) {
+				node.boundsMin[a] = (&c.bmin.x)[a];
+				node.boundsMax[a] = (&c.bmax.x)[a];
+			}
+			node.error = c.error;
+			node.level = l;
+			node.firstIndex = (uint32_t)indices.size();
+			node.indexCount = (uint32_t)c.tris.size();
+			indices.insert(indices.end(), c.tris.begin(), c.tris.end());
+			int i = k % s, j = k / s;
+			for (int q = 0; q < 4; q++) {
+				node.children[q] = l == 0 ? -1 : first[depth - l + 1] + (2 * j + q / 2) * (2 * s) + 2 * i + q % 2;
+			}
+			nodes.push_back(node);
+		}
+	}
+	return true;
+}
+
+static bool readLod(const string &file, uint64_t hash, uint64_t size, uint32_t vertexCount,
+	vector<TerrainLodNode> &nodes, vector<uint32_t> &indices, int &depth)
+{
+	MappedFile lod;
+	if (!lod.open(file) || lod.size() < sizeof(TerrainLodHeader)) return false;
+
+	TerrainLodHeader h;
+	memcpy(&h, lod.data(), sizeof(h));
+	if (memcmp(h.magic, lodMagic, 4) != 0 || h.version != lodVersion ||
+		h.sourceHash != hash || h.sourceSize != size || h.vertexCount != vertexCount) return false;
+	if (h.nodeCount == 0 || h.nodesOffset + (size_t)h.nodeCount * sizeof(TerrainLodNode) > lod.size() ||
+		h.indicesOffset + (size_t)h.indexCount * sizeof(uint32_t) > lod.size()) return false;
+
+	const TerrainLodNode *n = (const TerrainLodNode *)(lod.data() + h.nodesOffset);
+	const uint32_t *i = (const uint32_t *)(lod.data() + h.indicesOffset);
+	nodes.assign(n, n + h.nodeCount);
+	indices.assign(i, i + h.indexCount);
+	depth = h.depth;
+	return true;
+}
+
+// header, nodes, indices.  Through a temporary file like the mesh cache.
+//
+static bool writeLod(const string &file, uint64_t hash, uint64_t size, uint32_t vertexCount,
+	const vector<TerrainLodNode> &nodes, const vector<uint32_t> &indices, int depth)
+{
+	TerrainLodHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, lodMagic, 4);
+	h.version = lodVersion;
+	h.sourceHash = hash;
+	h.sourceSize = size;
+	h.vertexCount = vertexCount;
+	h.nodeCount = (uint32_t)nodes.size();
+	h.indexCount = (uint32_t)indices.size();
+	h.depth = depth;
+	h.nodesOffset = align16(sizeof(h));
+	h.indicesOffset = align16(h.nodesOffset + nodes.size() * sizeof(TerrainLodNode));
+
+	string tmp = file + ".tmp";
+	FILE *f = fopen(tmp.c_str(), "wb");
+	if (!f) return false;
+	static const char zeros[16] = {};
+	size_t nodeBytes = nodes.size() * sizeof(TerrainLodNode);
+	size_t indexBytes = indices.size() * sizeof(uint32_t);
+	bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+		fwrite(zeros, 1, h.nodesOffset - sizeof(h), f) == h.nodesOffset - sizeof(h) &&
+		fwrite(&nodes[0], 1, nodeBytes, f) == nodeBytes &&
+		fwrite(zeros, 1, h.indicesOffset - h.nodesOffset - nodeBytes, f) == h.indicesOffset - h.nodesOffset - nodeBytes &&
+		fwrite(&indices[0], 1, indexBytes, f) == indexBytes;
+	ok = (fclose(f) == 0) && ok;
+
+	if (ok) {
+		remove(file.c_str());
+		ok = rename(tmp.c_str(), file.c_str()) == 0;
+	}
+	if (!ok) remove(tmp.c_str());
+	return ok;
+}
+
+bool TerrainLod::load(const string &path, const ofMesh &mesh) {
+	nodes.clear();
+	indices.clear();
+	uint64_t hash, size;
+	if (!hashSource(path, hash, size)) {
+		cout << "can't open " << path << endl;
+		return false;
+	}
+	uint32_t vertexCount = (uint32_t)mesh.getNumVertices();
+	string file = lodPath(path);
+	if (!readLod(file, hash, size, vertexCount, nodes, indices, depth)) {
+		cout << "no terrain lod for " << path << ", building it" << endl;
+		if (!buildLod(mesh, nodes, indices, depth)) return false;
+		if (!writeLod(file, hash, size, vertexCount, nodes, indices, depth)) cout << "can't write " << file << endl;
+	}
+	vertices.resize(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++) vertices[i] = mesh.getVertex(i);
+	return true;
+}
+
+bool TerrainLod::build(const string &path) {
+	ofMesh mesh;
+	TerrainLod lod;
+	uint64_t hash, size;
+	if (!loadMeshCached(path, mesh) || !hashSource(path, hash, size) ||
+		!buildLod(mesh, lod.nodes, lod.indices, lod.depth)) {
+		cout << "can't build the terrain lod of " << path << endl;
+		return false;
+	}
+	string file = lodPath(path);
+	if (!writeLod(file, hash, size, (uint32_t)mesh.getNumVertices(), lod.nodes, lod.indices, lod.depth)) {
+		cout << "can't write " << file << endl;
+		return false;
+	}
+	cout << file << ": " << lod.nodes.size() << " chunks" << endl;
+	for (int l = 0; l <= lod.depth; l++) {
+		float error = 0;
+		for (const TerrainLodNode &n : lod.nodes) if ((int)n.level == l) error = std::max(error, n.error);
+		printf("  level %d   %8d triangles   error %.3f\n", l, lod.trianglesAt(l), error);
+	}
+	return true;
+}
+
+int TerrainLod::trianglesAt(int level) const {
+	int n = 0;
+	for (const TerrainLodNode &node : nodes) {
+		if ((int)node.level == level) n += node.indexCount / 3;
+	}
+	return n;
+}
+
+void TerrainLod::select(const ofVec3f &eye, float fovY, float viewportHeight, float maxPixels,
+	vector<int> &out) const
+{
+	out.clear();
+	if (nodes.empty()) return;
+	float pixelsPerUnit = viewportHeight / (2 * tanf(ofDegToRad(fovY) / 2));   // at distance 1
+	selectNode(0, eye, pixelsPerUnit, maxPixels, out);
+}
+
+// the error of a node shrinks on screen with the distance to its box
+//
+void TerrainLod::selectNode(int i, const ofVec3f &eye, float pixelsPerUnit, float maxPixels,
+	vector<int> &out) const
+{
+	const TerrainLodNode &n = nodes[i];
+	if (n.indexCount == 0) return;
+	float d2 = 0;
+	for (int a = 0; a < 3; a++) {
+		float e = (&eye.x)[a];
+		float d = std::max(std::max(n.boundsMin[a] - e, 0.0f), e - n.boundsMax[a]);
+		d2 += d * d;
+	}
+	if (n.level == 0 || n.error * pixelsPerUnit <= maxPixels * sqrtf(d2)) {
+		out.push_back(i);
+		return;
+	}
+	for (int c = 0; c < 4; c++) selectNode(n.children[c], eye, pixelsPerUnit, maxPixels, out);
+}
+
+// every cell gets the highest corner of the triangles of the level over
+// it, plus their error.  A source vertex is at most error above the
+// triangle it is under, so none is above its cell.  The cells are then
+// spread over their neighbors within r, so a query is a single lookup.
+//
+void TerrainLod::setBroadPhase(int level, float r) {
+	ceilings.clear();
+	if (nodes.empty()) return;
+	level = ofClamp(level, 0, depth);
+	const TerrainLodNode &root = nodes[0];
+	float w = root.boundsMax[0] - root.boundsMin[0];
+	float h = root.boundsMax[2] - root.boundsMin[2];
+	radius = std::max(r, 0.0f);
+	cellSize = std::max(std::max(w, h) / 256, 1e-6f);
+	gridMin.set(root.boundsMin[0], root.boundsMin[2]);
+	gridW = (int)(w / cellSize) + 1;
+	gridH = (int)(h / cellSize) + 1;
+	vector<float> tops(gridW * gridH, -FLT_MAX);
+
+	for (const TerrainLodNode &n : nodes) {
+		if ((int)n.level != level) continue;
+		for (uint32_t t = n.firstIndex; t < n.firstIndex + n.indexCount; t += 3) {
+			const ofVec3f &a = vertices[indices[t]], &b = vertices[indices[t + 1]], &c = vertices[indices[t + 2]];
+			float top = std::max(a.y, std::max(b.y, c.y)) + n.error;
+			int i0 = ofClamp((int)((std::min(a.x, std::min(b.x, c.x)) - gridMin.x) / cellSize), 0, gridW - 1);
+			int i1 = ofClamp((int)((std::max(a.x, std::max(b.x, c.x)) - gridMin.x) / cellSize), 0, gridW - 1);
+			int j0 = ofClamp((int)((std::min(a.z, std::min(b.z, c.z)) - gridMin.y) / cellSize), 0, gridH - 1);
+			int j1 = ofClamp((int)((std::max(a.z, std::max(b.z, c.z)) - gridMin.y) / cellSize), 0, gridH - 1);
+			for (int j = j0; j <= j1; j++) {
+				for (int i = i0; i <= i1; i++) {
+					float &y = tops[j * gridW + i];
+					y = std::max(y, top);
+				}
+			}
+		}
+	}
+
+	// a max filter over x and then over z, out to every cell that comes
+	// within radius of the one it is written to
+	//
+	int k = (int)ceilf(radius / cellSize);
+	vector<float> rows(tops.size());
+	for (int j = 0; j < gridH; j++) {
+		for (int i = 0; i < gridW; i++) {
+			float y = -FLT_MAX;
+			for (int d = std::max(i - k, 0); d <= std::min(i + k, gridW - 1); d++) y = std::max(y, tops[j * gridW + d]);
+			rows[j * gridW + i] = y;
+		}
+	}
+	ceilings.resize(tops.size());
+	for (int j = 0; j < gridH; j++) {
+		for (int i = 0; i < gridW; i++) {
+			float y = -FLT_MAX;
+			for (int d = std::max(j - k, 0); d <= std::min(j + k, gridH - 1); d++) y = std::max(y, rows[d * gridW + i]);
+			ceilings[j * gridW + i] = y;
+		}
+	}
+}
+
+float TerrainLod::ceiling(float x, float z) const {
+	if (ceilings.empty()) return FLT_MAX;
+	int i = (int)floorf((x - gridMin.x) / cellSize);
+	int j = (int)floorf((z - gridMin.y) / cellSize);
+	if (i >= 0 && i < gridW && j >= 0 && j < gridH) return ceilings[j * gridW + i];
+
+	// off the grid, but maybe still within radius of it
+	//
+	int k = (int)ceilf(radius / cellSize);
+	if (i < -k || i >= gridW + k || j < -k || j >= gridH + k) return -FLT_MAX;
+	return ceilings[ofClamp(j, 0, gridH - 1) * gridW + ofClamp(i, 0, gridW - 1)];
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Levels of detail of the terrain, built offline and stored next to the
+//  OBJ as <path>.sllod.
+//
+//  The terrain is cut into a quadtree of chunks over x and z.  A leaf is a
+//  chunk of the full resolution mesh, every node above it the union of its
+//  four children simplified (see MeshSimplify.h) to about a quarter of
+//  their triangles.  The outline of each node is locked while it is
+//  simplified, so it stays exactly the full resolution outline.  Where two
+//  chunks meet they therefore share the very same edges whatever level
+//  each one is drawn at: any cut through the tree is free of cracks.
+//
+//  The collapses keep vertices of the source mesh, so every node is just a
+//  range of indices into the vertices of the source: the terrain vbo is
+//  drawn with the ranges of the nodes that select() picks.
+//
+//  The error of a node is the largest vertical distance between its
+//  surface and a source vertex under it.  select() draws a node once its
+//  error is under maxPixels on screen and goes down to its children
+//  otherwise.  The same bound makes the coarse levels a broad phase for
+//  ground queries, see ceiling().
+//
+//  The file is keyed on the contents of the OBJ like MeshCache.  It is
+//  built on the first load that does not find a valid one, or ahead with
+//
+//      space_lander_ver3 --terrain-lod geo/moon-houdini.obj
+//
+struct TerrainLodHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	uint32_t vertexCount;     // of the source mesh
+	uint32_t nodeCount;
+	uint32_t indexCount;
+	uint32_t depth;           // levels below the root
+	uint32_t nodesOffset;
+	uint32_t indicesOffset;
+};
+
+struct TerrainLodNode {
+	float boundsMin[3];       // of the full resolution triangles under it
+	float boundsMax[3];
+	float error;              // world units, 0 at the leaves
+	uint32_t level;           // 0 = leaf
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t children[4];      // -1 for none
+};
+
+class TerrainLod {
+public:
+	// map the levels of the OBJ at path, building them from mesh (the
+	// same OBJ, as loadMeshCached() gives it) if there are none yet
+	//
+	bool load(const string &path, const ofMesh &mesh);
+	static bool build(const string &path);
+
+	bool isLoaded() const { return !nodes.empty(); }
+
+	// nodes to draw from eye, for a perspective view of vertical field of
+	// view fovY (degrees) on viewportHeight pixels
+	//
+	void select(const ofVec3f &eye, float fovY, float viewportHeight, float maxPixels,
+		vector<int> &out) const;
+
+	// no vertex of the terrain within radius (set by setBroadPhase()) of
+	// (x, z) is higher than this.  One lookup in a grid worked out from
+	// the triangles of one coarse level, raised by their error.  -FLT_MAX
+	// off the terrain, FLT_MAX without a grid.
+	//
+	float ceiling(float x, float z) const;
+	void setBroadPhase(int level, float radius);
+	float getBroadPhaseRadius() const { return radius; }
+
+	vector<TerrainLodNode> nodes;       // root first
+	vector<uint32_t> indices;
+	int depth = 0;
+	int trianglesAt(int level) const;
+
+private:
+	void selectNode(int node, const ofVec3f &eye, float pixelsPerUnit, float maxPixels,
+		vector<int> &out) const;
+
+	vector<ofVec3f> vertices;           // of the source, for the broad phase
+	vector<float> ceilings;
+	ofVec2f gridMin;
+	float cellSize = 0;
+	float radius = 0;
+	int gridW = 0, gridH = 0;
+};
@@ -0,0 +1,123 @@
+
+#include "AsyncLoader.h"
+#include <chrono>
+#include <stdio.h>
+
+AsyncLoader::~AsyncLoader() {
+	for (auto &job : jobs) {
+		if (job->thread.joinable()) job->thread.join();
+	}
+}
+
+double AsyncLoader::nowMs() {
+	return std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int AsyncLoader::add(const std::string &name, Step work, Step finish, const std::vector<int> &after) {
+	std::unique_ptr<Job> job(new Job());
+	job->name = name;
+	job->work = work;
+	job->finish = finish;
+	job->after = after;
+	jobs.push_back(std::move(job));
+	return (int)jobs.size() - 1;
+}
+
+// every job in "after" is done.  blocked is set if one of them failed.
+//
+bool AsyncLoader::ready(const Job &job, bool &blocked) const {
+	for (int i : job.after) {
+		int state = jobs[i]->state;
+		if (state == Failed) blocked = true;
+		if (state != Done) return false;
+	}
+	return true;
+}
+
+void AsyncLoader::update(double budgetMs) {
+	double start = nowMs();
+	bool finished = false;      // ran a finish half this frame
+
+	// finishing a job can make others ready, so go round until nothing
+	// changes
+	//
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (auto &p : jobs) {
+			Job &job = *p;
+			int state = job.state;
+
+			if (state == Waiting) {
+				bool blocked = false;
+				if (!ready(job, blocked)) {
+					if (blocked) {
+						job.state = Failed;
+						changed = true;
+					}
+					continue;
+				}
+				job.startMs = nowMs();
+				if (job.work) {
+					job.state = Working;
+					Job *j = &job;
+					job.thread = std::thread([j]() { j->state = j->work() ? Worked : Failed; });
+				}
+				else {
+					job.state = Worked;
+					changed = true;
+				}
+			}
+			else if (state == Worked || state == Failed) {
+				if (job.thread.joinable()) job.thread.join();
+				if (state == Failed) continue;
+
+				// at least one finish per frame, more while there is time
+				//
+				if (finished && nowMs() - start > budgetMs) return;
+				bool ok = !job.finish || job.finish();
+				job.ms = nowMs() - job.startMs;
+				job.state = ok ? Done : Failed;
+				finished = true;
+				changed = true;
+			}
+		}
+	}
+}
+
+bool AsyncLoader::isFinished() const {
+	for (auto &job : jobs) {
+		if (job->state != Done) return false;
+	}
+	return true;
+}
+
+bool AsyncLoader::hasFailed() const {
+	for (auto &job : jobs) {
+		if (job->state == Failed) return true;
+	}
+	return false;
+}
+
+float AsyncLoader::getProgress() const {
+	if (jobs.empty()) return 1;
+	int done = 0;
+	for (auto &job : jobs) {
+		if (job->state == Done) done++;
+	}
+	return (float)done / jobs.size();
+}
+
+std::string AsyncLoader::getReport() const {
+	static const char *names[] = { "waiting", "loading", "loading", "done", "failed" };
+	std::string report;
+	char line[128];
+	for (auto &job : jobs) {
+		int state = job->state;
+		if (state == Done) snprintf(line, sizeof(line), "%-20s %-8s %8.0f ms\n", job->name.c_str(), names[state], job->ms);
+		else snprintf(line, sizeof(line), "%-20s %s\n", job->name.c_str(), names[state]);
+		report += line;
+	}
+	return report;
+}
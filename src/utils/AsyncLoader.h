@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//  Startup jobs with dependencies, run in the background while the app
+//  keeps drawing frames.
+//
+//  A job has two optional halves.  "work" runs on a thread of its own and
+//  must not touch GL: parsing, decoding, building the octree.  "finish"
+//  then runs on the main thread from update() and does what needs the GL
+//  context: uploading textures and meshes, loading shaders and fonts.  A
+//  job starts as soon as every job it comes "after" is done, so each part
+//  of the app comes online as early as its inputs allow.  Either half
+//  returns false to fail the job, which also fails everything after it.
+//
+//      int mesh = loader.add("terrain", [&] { return parse(path, mesh); },
+//                                      [&] { vbo = mesh; return true; });
+//      loader.add("octree", [&] { octree.create(mesh, 8); return true; }, nullptr, { mesh });
+//
+//  update() is called once per frame on the main thread.  It runs finish
+//  halves until budgetMs is used up, so a frame only ever waits for the
+//  slowest single one.
+//
+class AsyncLoader {
+public:
+	typedef std::function<bool()> Step;
+
+	~AsyncLoader();
+
+	int add(const std::string &name, Step work, Step finish, const std::vector<int> &after = {});
+	void update(double budgetMs = 8);
+
+	bool isDone(int job) const { return jobs[job]->state == Done; }
+	bool isFinished() const;          // every job done
+	bool hasFailed() const;           // some job failed
+	float getProgress() const;        // fraction of jobs done
+	std::string getReport() const;    // one line per job with its state and time
+
+private:
+	enum State { Waiting, Working, Worked, Done, Failed };
+
+	struct Job {
+		std::string name;
+		Step work, finish;
+		std::vector<int> after;
+		std::atomic<int> state{ Waiting };
+		std::thread thread;
+		double startMs = 0;
+		double ms = 0;                // from start to done
+	};
+
+	bool ready(const Job &job, bool &blocked) const;
+	static double nowMs();
+
+	std::vector<std::unique_ptr<Job>> jobs;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+//  IEEE 754 half precision (16 bit) float conversion.
+//
+//  Used to store values that do not need full float precision in half the
+//  memory.  Rounds to nearest, flushes values below the smallest normal
+//  half (6.1e-5) to zero and saturates overflow to infinity.
+//
+
+inline uint16_t floatToHalf(float f) {
+	uint32_t x;
+	memcpy(&x, &f, 4);
+	uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+	uint32_t absx = x & 0x7FFFFFFF;
+
+	if (absx >= 0x7F800000) {                         // inf or nan
+		return sign | 0x7C00 | (absx > 0x7F800000 ? 0x200 : 0);
+	}
+	if (absx >= 0x477FF000) return sign | 0x7C00;     // too large, infinity
+	if (absx < 0x38800000) return sign;               // too small, zero
+
+	// rebias the exponent and round the mantissa to nearest
+	//
+	uint32_t h = (absx - 0x38000000 + 0x0FFF + ((absx >> 13) & 1)) >> 13;
+	return sign | (uint16_t)h;
+}
+
+inline float halfToFloat(uint16_t h) {
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1F;
+	uint32_t mant = h & 0x3FF;
+	uint32_t x;
+	if (exp == 0) x = sign;                                       // zero (no subnormals)
+	else if (exp == 31) x = sign | 0x7F800000 | (mant << 13);     // inf or nan
+	else x = sign | ((exp + 112) << 23) | (mant << 13);
+	float f;
+	memcpy(&f, &x, 4);
+	return f;
+}
@@ -0,0 +1,58 @@
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string &path) {
+	close();
+
+#ifdef _WIN32
+	HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(f, &fileSize);
+	length = (size_t)fileSize.QuadPart;
+	fileHandle = f;
+	if (length > 0) {
+		mapHandle = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapHandle) bytes = (const uint8_t *)MapViewOfFile((HANDLE)mapHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	fstat(fd, &st);
+	length = (size_t)st.st_size;
+	if (length > 0) {
+		void *p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) bytes = (const uint8_t *)p;
+	}
+	::close(fd);
+#endif
+	if (bytes == nullptr) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (bytes) UnmapViewOfFile(bytes);
+	if (mapHandle) CloseHandle((HANDLE)mapHandle);
+	if (fileHandle) CloseHandle((HANDLE)fileHandle);
+	mapHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (bytes) munmap((void *)bytes, length);
+#endif
+	bytes = nullptr;
+	length = 0;
+}
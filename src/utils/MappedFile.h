@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//  Read only memory mapping of a whole file (mmap, or MapViewOfFile on
+//  Windows).  The pages are only read from disk when touched, and stay in
+//  the OS cache between runs.
+//
+class MappedFile {
+public:
+	MappedFile() {}
+	~MappedFile() { close(); }
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	bool open(const std::string &path);
+	void close();
+
+	const uint8_t * data() const { return bytes; }
+	size_t size() const { return length; }
+	bool isOpen() const { return bytes != nullptr; }
+
+private:
+	const uint8_t *bytes = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void *fileHandle = nullptr;
+	void *mapHandle = nullptr;
+#endif
+};
@@ -0,0 +1,183 @@
+
+#include "Profiler.h"
+
+#ifdef SPACE_LANDER_PROFILE
+
+#include "ofMain.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+thread_local int ProfileZone::depth = 0;
+const int Profiler::historyFrames;
+
+// events kept for the export at most, in case frames are never ended
+//
+static const size_t maxEvents = 1 << 20;
+
+Profiler & Profiler::shared() {
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler() {
+	epoch = now();
+	frameZone = zone("frame");
+}
+
+int64_t Profiler::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int Profiler::threadIndex() {
+	static std::atomic<int> next(0);
+	thread_local int index = next++;
+	return index;
+}
+
+int Profiler::zone(const char *name) {
+	std::lock_guard<std::mutex> guard(lock);
+	for (int i = 0; i < (int)names.size(); i++) {
+		if (names[i] == name) return i;
+	}
+	names.push_back(name);
+	history.push_back(std::vector<float>(historyFrames, 0));
+	callHistory.push_back(std::vector<int>(historyFrames, 0));
+	frameTotal.push_back(0);
+	frameCalls.push_back(0);
+	return (int)names.size() - 1;
+}
+
+void Profiler::add(int zone, int64_t start, int64_t end, int depth) {
+	std::lock_guard<std::mutex> guard(lock);
+	frameTotal[zone] += (end - start) * 1e-6f;
+	frameCalls[zone]++;
+
+	// only keep the events while frames are being marked, else nothing
+	// would ever trim them
+	//
+	if (frameStart != 0 && events.size() < maxEvents) {
+		Event e = { zone, depth, threadIndex(), frame, start, end };
+		events.push_back(e);
+	}
+}
+
+void Profiler::beginFrame() {
+	std::lock_guard<std::mutex> guard(lock);
+	frameStart = now();
+}
+
+void Profiler::endFrame() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (frameStart == 0) return;
+	int64_t end = now();
+	frameTotal[frameZone] += (end - frameStart) * 1e-6f;
+	frameCalls[frameZone]++;
+	if (events.size() < maxEvents) {
+		Event e = { frameZone, -1, threadIndex(), frame, frameStart, end };
+		events.push_back(e);
+	}
+
+	int slot = frame % historyFrames;
+	for (int z = 0; z < (int)names.size(); z++) {
+		history[z][slot] = frameTotal[z];
+		callHistory[z][slot] = frameCalls[z];
+		frameTotal[z] = 0;
+		frameCalls[z] = 0;
+	}
+	frame++;
+
+	while (!events.empty() && events.front().frame + traceFrames <= frame)
+		events.pop_front();
+}
+
+Profiler::Stats Profiler::getStats(int zone) const {
+	std::lock_guard<std::mutex> guard(lock);
+	Stats s;
+	int n = std::min((int)frame, historyFrames);
+	if (n == 0 || zone < 0 || zone >= (int)names.size()) return s;
+
+	std::vector<float> t(history[zone].begin(), history[zone].begin() + n);
+	std::sort(t.begin(), t.end());
+	float sum = 0;
+	int calls = 0;
+	for (int i = 0; i < n; i++) {
+		sum += t[i];
+		calls += callHistory[zone][i];
+	}
+	s.mean = sum / n;
+	s.p50 = t[n / 2];
+	s.p95 = t[std::min(n - 1, (int)(n * 0.95f))];
+	s.max = t[n - 1];
+	s.calls = (float)calls / n;
+	return s;
+}
+
+// one line per zone that ran in the last historyFrames frames
+//
+std::string Profiler::getReport() const {
+	std::vector<std::string> zones;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		zones = names;
+	}
+	char line[160];
+	snprintf(line, sizeof(line), "%-28s %7s %7s %7s %7s %6s\n", "zone (ms/frame)", "mean", "p50", "p95", "max", "calls");
+	std::string report = line;
+	for (int z = 0; z < (int)zones.size(); z++) {
+		Stats s = getStats(z);
+		if (s.calls == 0) continue;
+		snprintf(line, sizeof(line), "%-28.28s %7.3f %7.3f %7.3f %7.3f %6.1f\n",
+			zones[z].c_str(), s.mean, s.p50, s.p95, s.max, s.calls);
+		report += line;
+	}
+	return report;
+}
+
+void Profiler::draw(float x, float y) const {
+	if (!showHud) return;
+	ofDrawBitmapStringHighlight(getReport(), x, y, ofColor(0, 0, 0, 180), ofColor::white);
+}
+
+//  one row per zone event, times in microseconds from program start
+//
+bool Profiler::writeCsv(const std::string &path) const {
+	FILE *f = fopen(path.c_str(), "w");
+	if (!f) {
+		cout << "Profiler: can't write " << path << endl;
+		return false;
+	}
+	std::lock_guard<std::mutex> guard(lock);
+	fprintf(f, "frame,thread,zone,depth,start_us,duration_us\n");
+	for (const Event &e : events) {
+		fprintf(f, "%u,%d,%s,%d,%.3f,%.3f\n", e.frame, e.thread, names[e.zone].c_str(), e.depth,
+			(e.start - epoch) * 1e-3, (e.end - e.start) * 1e-3);
+	}
+	fclose(f);
+	return true;
+}
+
+//  Chrome trace event format, complete ("X") events
+//
+bool Profiler::writeTrace(const std::string &path) const {
+	FILE *f = fopen(path.c_str(), "w");
+	if (!f) {
+		cout << "Profiler: can't write " << path << endl;
+		return false;
+	}
+	std::lock_guard<std::mutex> guard(lock);
+	fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	for (size_t i = 0; i < events.size(); i++) {
+		const Event &e = events[i];
+		fprintf(f, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, "
+			"\"args\": {\"frame\": %u}}%s\n",
+			names[e.zone].c_str(), e.thread, (e.start - epoch) * 1e-3, (e.end - e.start) * 1e-3,
+			e.frame, i + 1 < events.size() ? "," : "");
+	}
+	fprintf(f, "]}\n");
+	fclose(f);
+	return true;
+}
+
+#endif
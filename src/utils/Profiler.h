@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//  Frame profiler with scoped timing zones.
+//
+//      void ParticleSystem::step(float dt) {
+//          PROFILE_ZONE("ParticleSystem::step");
+//          ...
+//
+//  A zone times the rest of the enclosing scope.  Zones nest and may be
+//  opened on any thread.  The app brackets every frame with
+//  PROFILE_BEGIN_FRAME() / PROFILE_END_FRAME(); the per zone total of each
+//  of the last historyFrames frames feeds the HUD (mean, median, p95 and
+//  max), and every zone of the last traceFrames frames can be written out
+//  as CSV or as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+//
+//  Zones are meant for whole phases, not for inner loops: closing one
+//  takes a lock.
+//
+//  Profiling is on by default in debug builds only.  Without
+//  SPACE_LANDER_PROFILE the macros expand to nothing and the profiler is
+//  not compiled at all; define it to profile an optimized build, or
+//  define SPACE_LANDER_NO_PROFILE to turn it off in a debug build.
+//
+#if !defined(NDEBUG) && !defined(SPACE_LANDER_NO_PROFILE) && !defined(SPACE_LANDER_PROFILE)
+#define SPACE_LANDER_PROFILE
+#endif
+
+#ifdef SPACE_LANDER_PROFILE
+
+class Profiler {
+public:
+	static Profiler & shared();
+
+	int zone(const char *name);       // id of a zone, registered on first use
+	void add(int zone, int64_t start, int64_t end, int depth);
+	void beginFrame();
+	void endFrame();
+
+	struct Stats {
+		float mean = 0, p50 = 0, p95 = 0, max = 0;    // ms per frame
+		float calls = 0;                               // per frame
+	};
+	Stats getStats(int zone) const;
+	std::string getReport() const;
+	void draw(float x, float y) const;
+	bool writeCsv(const std::string &path) const;
+	bool writeTrace(const std::string &path) const;
+
+	static int64_t now();             // ns, steady clock
+	static int threadIndex();         // small id of the calling thread
+
+	bool showHud = false;
+	static const int historyFrames = 240;
+	int traceFrames = 600;
+
+private:
+	Profiler();
+
+	struct Event {
+		int zone;
+		int depth;
+		int thread;
+		uint32_t frame;
+		int64_t start, end;
+	};
+
+	mutable std::mutex lock;
+	std::vector<std::string> names;
+	std::vector<std::vector<float>> history;   // [zone][frame % historyFrames], ms
+	std::vector<std::vector<int>> callHistory;
+	std::vector<float> frameTotal;             // ms per zone this frame
+	std::vector<int> frameCalls;
+	std::deque<Event> events;                  // for the export
+	uint32_t frame = 0;                        // frames completed
+	int64_t frameStart = 0;
+	int64_t epoch;
+	int frameZone;
+};
+
+class ProfileZone {
+public:
+	ProfileZone(int zone) : id(zone), start(Profiler::now()) { depth++; }
+	~ProfileZone() {
+		depth--;
+		Profiler::shared().add(id, start, Profiler::now(), depth);
+	}
+
+private:
+	int id;
+	int64_t start;
+	static thread_local int depth;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_ZONE(name) \
+	static const int PROFILE_CONCAT(profileId, __LINE__) = Profiler::shared().zone(name); \
+	ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(PROFILE_CONCAT(profileId, __LINE__))
+#define PROFILE_BEGIN_FRAME() Profiler::shared().beginFrame()
+#define PROFILE_END_FRAME() Profiler::shared().endFrame()
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_BEGIN_FRAME()
+#define PROFILE_END_FRAME()
+
+#endif
@@ -0,0 +1,40 @@
+#include "RadixSort.h"
+
+void radixSort(std::vector<uint32_t> &keys, std::vector<int> &values,
+	std::vector<uint32_t> &keysTmp, std::vector<int> &valuesTmp, int keyBits)
+{
+	const int digitBits = 11;
+	const int buckets = 1 << digitBits;
+	const int n = (int)keys.size();
+	if (n < 2) return;
+	keysTmp.resize(n);
+	valuesTmp.resize(n);
+
+	int offsets[buckets];
+	for (int shift = 0; shift < keyBits; shift += digitBits) {
+
+		// histogram of this digit, then turn it into start offsets
+		//
+		for (int b = 0; b < buckets; b++) offsets[b] = 0;
+		for (int i = 0; i < n; i++) offsets[(keys[i] >> shift) & (buckets - 1)]++;
+
+		// all keys share this digit, nothing to move
+		//
+		if (offsets[(keys[0] >> shift) & (buckets - 1)] == n) continue;
+
+		int sum = 0;
+		for (int b = 0; b < buckets; b++) {
+			int c = offsets[b];
+			offsets[b] = sum;
+			sum += c;
+		}
+
+		for (int i = 0; i < n; i++) {
+			int dst = offsets[(keys[i] >> shift) & (buckets - 1)]++;
+			keysTmp[dst] = keys[i];
+			valuesTmp[dst] = values[i];
+		}
+		keys.swap(keysTmp);
+		values.swap(valuesTmp);
+	}
+}
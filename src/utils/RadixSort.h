@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+//  Stable LSD radix sort of (key, value) pairs by key, 11 bits per pass.
+//
+//  keys and values are sorted in place, keysTmp / valuesTmp are scratch
+//  space the caller keeps around so repeated sorts do not allocate.  Only
+//  the low keyBits bits of the keys are looked at (30 bit Morton codes
+//  take three passes).
+//
+void radixSort(std::vector<uint32_t> &keys, std::vector<int> &values,
+	std::vector<uint32_t> &keysTmp, std::vector<int> &valuesTmp, int keyBits = 32);
+
+// map a float to a uint32 with the same ordering, for sorting floats
+//
+inline uint32_t floatToSortableKey(float f) {
+	union { float f; uint32_t u; } v;
+	v.f = f;
+	return (v.u & 0x80000000u) ? ~v.u : (v.u | 0x80000000u);
+}
+
+// interleave the low 10 bits of x, y, z into a 30 bit Morton code
+//
+inline uint32_t mortonCode(uint32_t x, uint32_t y, uint32_t z) {
+	auto spread = [](uint32_t v) {
+		v &= 0x3FF;
+		v = (v | (v << 16)) & 0x030000FF;
+		v = (v | (v << 8)) & 0x0300F00F;
+		v = (v | (v << 4)) & 0x030C30C3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	};
+	return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+}
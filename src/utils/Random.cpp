@@ -0,0 +1,113 @@
+#include "Random.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RANDOM_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+static inline uint64_t splitmix64(uint64_t &x) {
+	uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+static inline uint32_t rotl(uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+void RandomStream::setSeed(uint64_t seed, uint64_t stream) {
+
+	// mix seed and stream id so neighbouring ids give unrelated states
+	//
+	uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ull);
+	uint64_t a = splitmix64(x);
+	uint64_t b = splitmix64(x);
+	s[0] = (uint32_t)a;
+	s[1] = (uint32_t)(a >> 32);
+	s[2] = (uint32_t)b;
+	s[3] = (uint32_t)(b >> 32);
+	if ((s[0] | s[1] | s[2] | s[3]) == 0) s[0] = 1;
+
+	for (int lane = 0; lane < 4; lane++) {
+		a = splitmix64(x);
+		b = splitmix64(x);
+		lanes[0][lane] = (uint32_t)a;
+		lanes[1][lane] = (uint32_t)(a >> 32);
+		lanes[2][lane] = (uint32_t)b;
+		lanes[3][lane] = (uint32_t)(b >> 32) | 1;
+	}
+}
+
+// seed and step are hashed apart before they are combined: with seed + step
+// seed 1 at step 1 was seed 2 at step 0, neighbouring seeds replayed each
+// other one step late
+//
+RandomStream RandomStream::forChunk(uint64_t seed, uint64_t step, int chunk) {
+	uint64_t x = seed;
+	uint64_t y = step * 0x9E3779B97F4A7C15ull;
+	return RandomStream(splitmix64(x) ^ splitmix64(y), (uint64_t)chunk + 1);
+}
+
+uint32_t RandomStream::next() {
+	const uint32_t result = s[0] + s[3];
+	const uint32_t t = s[1] << 9;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 11);
+	return result;
+}
+
+void RandomStream::fill(float *out, int count, float min, float max) {
+	const float scale = (max - min) * (1.0f / 16777216.0f);
+	int i = 0;
+
+#ifdef RANDOM_USE_SSE2
+	__m128i s0 = _mm_loadu_si128((const __m128i *)lanes[0]);
+	__m128i s1 = _mm_loadu_si128((const __m128i *)lanes[1]);
+	__m128i s2 = _mm_loadu_si128((const __m128i *)lanes[2]);
+	__m128i s3 = _mm_loadu_si128((const __m128i *)lanes[3]);
+	const __m128 vscale = _mm_set1_ps(scale);
+	const __m128 vmin = _mm_set1_ps(min);
+	for (; i + 4 <= count; i += 4) {
+		__m128i result = _mm_add_epi32(s0, s3);
+		__m128i t = _mm_slli_epi32(s1, 9);
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, t);
+		s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+		__m128 f = _mm_cvtepi32_ps(_mm_srli_epi32(result, 8));
+		_mm_storeu_ps(out + i, _mm_add_ps(vmin, _mm_mul_ps(f, vscale)));
+	}
+	_mm_storeu_si128((__m128i *)lanes[0], s0);
+	_mm_storeu_si128((__m128i *)lanes[1], s1);
+	_mm_storeu_si128((__m128i *)lanes[2], s2);
+	_mm_storeu_si128((__m128i *)lanes[3], s3);
+#else
+	for (; i + 4 <= count; i += 4) {
+		for (int lane = 0; lane < 4; lane++) {
+			uint32_t result = lanes[0][lane] + lanes[3][lane];
+			uint32_t t = lanes[1][lane] << 9;
+			lanes[2][lane] ^= lanes[0][lane];
+			lanes[3][lane] ^= lanes[1][lane];
+			lanes[1][lane] ^= lanes[2][lane];
+			lanes[0][lane] ^= lanes[3][lane];
+			lanes[2][lane] ^= t;
+			lanes[3][lane] = rotl(lanes[3][lane], 11);
+			out[i + lane] = min + (float)(result >> 8) * scale;
+		}
+	}
+#endif
+
+	// tail
+	//
+	for (; i < count; i++) {
+		out[i] = min + (float)(next() >> 8) * scale;
+	}
+}
@@ -0,0 +1,33 @@
+#include "SimClock.h"
+
+SimClock::SimClock(float dt, int maxSubsteps) {
+	this->dt = dt;
+	this->maxSubsteps = maxSubsteps;
+	reset();
+}
+
+void SimClock::reset() {
+	accumulator = 0;
+	time = 0;
+	steps = 0;
+}
+
+int SimClock::advance(float frameTime) {
+	if (frameTime < 0) frameTime = 0;
+
+	// a long hitch (window drag, breakpoint) would otherwise ask for
+	// hundreds of steps which makes the next frame even longer.
+	//
+	float maxFrame = dt * maxSubsteps;
+	if (frameTime > maxFrame) frameTime = maxFrame;
+
+	accumulator += frameTime;
+	int n = 0;
+	while (accumulator >= dt && n < maxSubsteps) {
+		accumulator -= dt;
+		time += dt;
+		steps++;
+		n++;
+	}
+	return n;
+}
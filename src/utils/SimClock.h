@@ -0,0 +1,30 @@
+#pragma once
+
+//  Fixed timestep simulation clock.
+//
+//  Render frames feed their wall time into an accumulator which is drained
+//  in steps of exactly "dt" seconds, so the physics no longer depends on the
+//  frame rate and a run can be reproduced step for step.  Whatever is left in
+//  the accumulator is exposed as alpha() for interpolating the rendered state
+//  between the last two simulation steps.
+//
+class SimClock {
+public:
+	SimClock(float dt = 1.0f / 120.0f, int maxSubsteps = 8);
+
+	// add frameTime seconds of wall time, return the number of fixed
+	// steps that should be simulated this frame.
+	//
+	int advance(float frameTime);
+
+	// blend factor [0, 1) between the previous and the current step
+	//
+	float alpha() const { return accumulator / dt; }
+	void reset();
+
+	float dt;               // sec per simulation step
+	int maxSubsteps;        // cap on steps per frame (avoids the spiral of death)
+	float accumulator;      // sec of wall time not yet simulated
+	double time;            // sec of simulated time
+	unsigned long steps;    // total number of steps taken
+};
@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int numThreads) {
+	nextChunk = 0;
+	chunksDone = 0;
+	if (numThreads <= 0) {
+		numThreads = (int)std::thread::hardware_concurrency() - 1;
+	}
+	for (int i = 0; i < numThreads; i++) {
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	wake.notify_all();
+	for (unsigned int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+ThreadPool & ThreadPool::shared() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::parallelFor(int count, int chunkSize, const Kernel &kernel) {
+	if (count <= 0) return;
+	if (chunkSize < 1) chunkSize = 1;
+
+	// no workers, a single chunk, or the pool is already running a loop
+	// (nested call): do the work right here.
+	//
+	std::unique_lock<std::mutex> running(runLock, std::try_to_lock);
+	if (!running.owns_lock() || workers.empty() || count <= chunkSize) {
+		for (int begin = 0; begin < count; begin += chunkSize) {
+			kernel(begin, std::min(begin + chunkSize, count));
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		this->kernel = &kernel;
+		this->count = count;
+		this->chunkSize = chunkSize;
+		numChunks = (count + chunkSize - 1) / chunkSize;
+		nextChunk = 0;
+		chunksDone = 0;
+		generation++;
+	}
+	wake.notify_all();
+
+	runChunks();
+
+	// also wait for the workers to leave runChunks() so none of them can
+	// pick up a chunk of the next loop while it is being set up.
+	//
+	std::unique_lock<std::mutex> guard(lock);
+	finished.wait(guard, [this] { return chunksDone == numChunks && active == 0; });
+
+	// still under the lock, so a worker waking after this skips the loop
+	//
+	this->kernel = nullptr;
+}
+
+// grab chunks until there are none left
+//
+void ThreadPool::runChunks() {
+	int chunk;
+	while ((chunk = nextChunk++) < numChunks) {
+		int begin = chunk * chunkSize;
+		int end = std::min(begin + chunkSize, count);
+		(*kernel)(begin, end);
+		if (++chunksDone == numChunks) {
+			std::lock_guard<std::mutex> guard(lock);
+			finished.notify_all();
+		}
+	}
+}
+
+void ThreadPool::workerLoop() {
+	unsigned int seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this, seen] { return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+
+			// woken late, after the loop was finished (or all of its
+			// chunks handed out): sit this generation out
+			//
+			if (kernel == nullptr || nextChunk >= numChunks) continue;
+			active++;
+		}
+		runChunks();
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (--active == 0) finished.notify_all();
+		}
+	}
+}
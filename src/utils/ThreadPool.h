@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//  Persistent pool of worker threads for data parallel loops.
+//
+//  parallelFor() splits [0, count) into fixed size chunks and hands them out
+//  to the workers; the calling thread works on chunks too and returns once
+//  every chunk is done.  The chunk boundaries only depend on count and
+//  chunkSize, never on the number of threads, so a kernel that only writes
+//  to its own chunk produces the same result on any machine.
+//
+//  A parallelFor() issued while the pool is busy (for example from inside
+//  a kernel) simply runs serially on the calling thread.
+//
+class ThreadPool {
+public:
+	ThreadPool(int numThreads = 0);    // 0 = one worker per core minus the caller
+	~ThreadPool();
+
+	typedef std::function<void(int begin, int end)> Kernel;
+	void parallelFor(int count, int chunkSize, const Kernel &kernel);
+
+	int size() const { return (int)workers.size() + 1; }   // including the caller
+
+	static ThreadPool & shared();
+
+private:
+	void workerLoop();
+	void runChunks();
+
+	std::vector<std::thread> workers;
+	std::mutex runLock;                // one parallelFor at a time
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable finished;
+
+	const Kernel *kernel = nullptr;
+	int count = 0;
+	int chunkSize = 1;
+	int numChunks = 0;
+	std::atomic<int> nextChunk;
+	std::atomic<int> chunksDone;
+	unsigned int generation = 0;
+	int active = 0;                    // workers inside runChunks()
+	bool quit = false;
+};
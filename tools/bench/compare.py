@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+#
+#  compare.py - compare two bench result files case by case.
+#
+#      python3 compare.py base.json new.json [--threshold 10]
+#
+#  Prints the change in median time per item for every case found in both
+#  files and exits with 1 if any got slower by more than the threshold
+#  (in percent), so it can gate a CI job.
+
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    cases = {}
+    for r in data["results"]:
+        params = " ".join("%s=%g" % (k, v) for k, v in r["params"].items())
+        cases[(r["name"] + " " + params).strip()] = r["ns_per_item"]
+    return cases
+
+
+def main(argv):
+    threshold = 10.0
+    if "--threshold" in argv:
+        i = argv.index("--threshold")
+        threshold = float(argv[i + 1])
+        del argv[i:i + 2]
+    if len(argv) != 3:
+        print("usage: compare.py base.json new.json [--threshold percent]")
+        return 2
+
+    base = load(argv[1])
+    new = load(argv[2])
+    regressions = 0
+    compared = 0
+    for key in sorted(base):
+        if key not in new:
+            continue
+        compared += 1
+        change = (new[key] - base[key]) / base[key] * 100 if base[key] > 0 else 0
+        mark = ""
+        if change > threshold:
+            mark = "  SLOWER"
+            regressions += 1
+        elif change < -threshold:
+            mark = "  faster"
+        print("%-56s %10.2f %10.2f ns/item %+7.1f%%%s" % (key, base[key], new[key], change, mark))
+
+    for key in sorted(set(new) - set(base)):
+        print("%-56s %10s %10.2f ns/item     new" % (key, "-", new[key]))
+
+    print("%d of %d cases slower by more than %g%%" % (regressions, compared, threshold))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,100 @@
+
+#include "Bench.h"
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+bool BenchRunner::selected(const std::string &name) const {
+	return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void BenchRunner::run(const std::string &name, const BenchParams &params, double items,
+	const Fn &body, const Fn &setup)
+{
+	if (!selected(name)) return;
+	typedef std::chrono::steady_clock Clock;
+
+	// one untimed call first to fault in memory and warm the caches
+	//
+	if (setup) setup();
+	body();
+
+	std::vector<double> times;
+	double total = 0;
+	while ((total < minTime || (int)times.size() < minSamples) && (int)times.size() < maxSamples) {
+		if (setup) setup();
+		Clock::time_point start = Clock::now();
+		body();
+		double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		times.push_back(ns);
+		total += ns * 1e-9;
+	}
+	std::sort(times.begin(), times.end());
+
+	BenchResult r;
+	r.name = name;
+	r.params = params;
+	r.samples = (int)times.size();
+	r.items = std::max(items, 1.0);
+	r.minNs = times.front();
+	r.maxNs = times.back();
+	r.medianNs = times[times.size() / 2];
+	double sum = 0;
+	for (double t : times) sum += t;
+	r.meanNs = sum / times.size();
+	results.push_back(r);
+
+	std::string label = name;
+	for (auto &p : params) {
+		char buf[64];
+		snprintf(buf, sizeof(buf), " %s=%g", p.first.c_str(), p.second);
+		label += buf;
+	}
+	printf("%-52s %12.3f us  %10.2f ns/item  (%d samples)\n",
+		label.c_str(), r.medianNs / 1000, r.nsPerItem(), r.samples);
+	fflush(stdout);
+}
+
+//  one result per line so a diff of two files lines up
+//
+bool BenchRunner::writeJson(const std::string &path) const {
+	FILE *f = fopen(path.c_str(), "w");
+	if (!f) {
+		printf("bench: can't write %s\n", path.c_str());
+		return false;
+	}
+
+	char stamp[32];
+	time_t now = time(nullptr);
+	strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+#ifdef NDEBUG
+	const char *build = "release";
+#else
+	const char *build = "debug";
+#endif
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"timestamp\": \"%s\",\n", stamp);
+	fprintf(f, "  \"build\": \"%s\",\n", build);
+#ifdef __VERSION__
+	fprintf(f, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+	fprintf(f, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(f, "  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult &r = results[i];
+		fprintf(f, "    {\"name\": \"%s\", \"params\": {", r.name.c_str());
+		for (size_t j = 0; j < r.params.size(); j++) {
+			fprintf(f, "%s\"%s\": %g", j ? ", " : "", r.params[j].first.c_str(), r.params[j].second);
+		}
+		fprintf(f, "}, \"samples\": %d, \"items\": %g, \"min_ns\": %.1f, \"median_ns\": %.1f, "
+			"\"mean_ns\": %.1f, \"max_ns\": %.1f, \"ns_per_item\": %.3f}%s\n",
+			r.samples, r.items, r.minNs, r.medianNs, r.meanNs, r.maxNs, r.nsPerItem(),
+			i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+	fclose(f);
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+//  Minimal benchmark harness.
+//
+//  run() calls the body over and over, one sample per call, until it has
+//  spent minTime seconds and taken at least minSamples samples.  An
+//  optional setup runs before every sample and is not timed, for cases
+//  that consume their input (e.g. spawning into an empty system).  Each
+//  case reports min / median / mean / max time per sample; "items" is the
+//  amount of work in one sample (particles, queries) and gives the per
+//  item cost that is the number to compare between runs.
+//
+typedef std::vector<std::pair<std::string, double>> BenchParams;
+
+struct BenchResult {
+	std::string name;
+	BenchParams params;
+	int samples = 0;
+	double items = 1;
+	double minNs = 0;
+	double medianNs = 0;
+	double meanNs = 0;
+	double maxNs = 0;
+
+	double nsPerItem() const { return medianNs / items; }
+};
+
+class BenchRunner {
+public:
+	typedef std::function<void()> Fn;
+
+	bool selected(const std::string &name) const;
+	void run(const std::string &name, const BenchParams &params, double items,
+		const Fn &body, const Fn &setup = Fn());
+	bool writeJson(const std::string &path) const;
+
+	double minTime = 0.5;      // sec spent per case
+	int minSamples = 5;
+	int maxSamples = 10000;
+	std::string filter;        // only run cases whose name contains this
+
+	std::vector<BenchResult> results;
+};
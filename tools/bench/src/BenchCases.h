@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Bench.h"
+
+//  Benchmark cases, grouped by the module they exercise.  "quick" skips
+//  the largest sizes so a run stays under a minute.
+//
+void benchOctree(BenchRunner &runner, bool quick);
+void benchParticles(BenchRunner &runner, bool quick);
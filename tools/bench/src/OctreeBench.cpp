@@ -0,0 +1,107 @@
+
+#include "BenchCases.h"
+#include "ofMain.h"
+#include "octree/Octree.h"
+#include "utils/Random.h"
+#include <memory>
+
+//  n x n vertex height field over a 200 x 200 square, two triangles per
+//  cell, bumpy enough that the octree leaves are not all one plane
+//
+static void makeTerrain(int n, ofMesh &mesh) {
+	mesh.clear();
+	float size = 200;
+	for (int z = 0; z < n; z++) {
+		for (int x = 0; x < n; x++) {
+			float fx = x * size / (n - 1) - size / 2;
+			float fz = z * size / (n - 1) - size / 2;
+			float y = 4 * sinf(fx * 0.07f) * cosf(fz * 0.05f) + 1.5f * sinf(fx * 0.31f + fz * 0.23f);
+			mesh.addVertex(ofVec3f(fx, y, fz));
+		}
+	}
+	for (int z = 0; z + 1 < n; z++) {
+		for (int x = 0; x + 1 < n; x++) {
+			unsigned int i = z * n + x;
+			mesh.addIndex(i);
+			mesh.addIndex(i + n);
+			mesh.addIndex(i + 1);
+			mesh.addIndex(i + 1);
+			mesh.addIndex(i + n);
+			mesh.addIndex(i + n + 1);
+		}
+	}
+}
+
+static Ray makeRay(const ofVec3f &o, const ofVec3f &d) {
+	return Ray(Vector3(o.x, o.y, o.z), Vector3(d.x, d.y, d.z));
+}
+
+void benchOctree(BenchRunner &runner, bool quick) {
+	const int queries = 1024;
+
+	vector<int> sizes = { 65, 129, 257 };
+	vector<int> depths = { 6, 8, 10 };
+	if (quick) sizes.pop_back();
+
+	for (int n : sizes) {
+		ofMesh terrain;
+		makeTerrain(n, terrain);
+		double vertices = terrain.getNumVertices();
+
+		for (int levels : depths) {
+			BenchParams params = { { "vertices", vertices }, { "levels", (double)levels } };
+
+			std::unique_ptr<Octree> tree;
+			runner.run("octree/create", params, vertices,
+				[&]() { tree->create(terrain, levels); },
+				[&]() { tree.reset(new Octree()); });
+
+			bool queried = runner.selected("octree/ray") || runner.selected("octree/point") ||
+				runner.selected("octree/pick");
+			if (!queried || n != sizes.back()) continue;
+
+			// queries run against the largest mesh only, the same kinds
+			// LanderSim does each step (altitude ray, contact point) and
+			// on a mouse click (pick)
+			//
+			Octree octree;
+			octree.create(terrain, levels);
+
+			RandomStream rng(7);
+			vector<ofVec3f> ground(queries);
+			for (int i = 0; i < queries; i++) {
+				int v = (int)(rng.uniform() * vertices) % (int)vertices;
+				ground[i] = terrain.getVertex(v);
+			}
+
+			vector<Ray> down(queries);
+			for (int i = 0; i < queries; i++) {
+				down[i] = makeRay(ground[i] + ofVec3f(0, 30, 0), ofVec3f(0, -1, 0));
+			}
+			int hits = 0;
+			runner.run("octree/ray", params, queries, [&]() {
+				TreeNode node;
+				for (int i = 0; i < queries; i++) hits += octree.intersect(down[i], octree.root, node);
+			});
+
+			runner.run("octree/point", params, queries, [&]() {
+				TreeNode node;
+				for (int i = 0; i < queries; i++) hits += octree.intersect(ground[i], octree.root, node);
+			});
+
+			ofVec3f eye(0, 120, 160);
+			vector<Ray> picks(queries);
+			for (int i = 0; i < queries; i++) {
+				picks[i] = makeRay(eye, (ground[i] - eye).getNormalized());
+			}
+			runner.run("octree/pick", params, queries, [&]() {
+				vector<TreeNode> nodes;
+				for (int i = 0; i < queries; i++) {
+					nodes.clear();
+					hits += octree.intersect(picks[i], octree.root, nodes);
+				}
+			});
+			if (hits == 0) cout << "bench: no octree query hit anything" << endl;
+		}
+	}
+}
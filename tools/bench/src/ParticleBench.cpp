@@ -0,0 +1,163 @@
+
+#include "BenchCases.h"
+#include "ofMain.h"
+#include "particle/ParticleSystem.h"
+#include "particle/StaticParticleSystem.h"
+#include "particle/CompactParticleSystem.h"
+#include "particle/ParticleEmitter.h"
+#include <memory>
+
+static const float dt = 1.0f / 120;
+static const int reorderPeriod = 16;
+
+static Particle neverExpiring() {
+	Particle p;
+	p.lifespan = -1;
+	return p;
+}
+
+//  n particles in a 20 unit cube, built from neverExpiring() so every
+//  update steps the same count
+//
+static void fill(Particle *p, int n, RandomStream &rng) {
+	for (int i = 0; i < n; i++) {
+		p[i].position.set(rng.uniform(-10, 10), rng.uniform(0, 20), rng.uniform(-10, 10));
+		p[i].velocity.set(rng.uniform(-1, 1), rng.uniform(-1, 1), rng.uniform(-1, 1));
+	}
+}
+
+static void benchUpdate(BenchRunner &runner, const vector<int> &sizes) {
+	GravityForce gravity(ofVec3f(0, -1.62, 0));
+	TurbulenceForce turbulence(ofVec3f(-2, 0, -2), ofVec3f(2, 0, 2));
+
+	for (int n : sizes) {
+		for (int threaded = 0; threaded < 2; threaded++) {
+			BenchParams params = { { "particles", (double)n }, { "threaded", (double)threaded } };
+
+			// forces through the virtual updateForces() interface, with the
+			// particles in the order they were added and sorted by Morton
+			// code every reorderPeriod steps.  A sample is a whole period, the
+			// median would leave out the steps that sort.
+			//
+			for (int reorder : { 0, reorderPeriod }) {
+				if (!runner.selected("particles/update")) break;
+				ParticleSystem sys;
+				sys.setThreaded(threaded != 0);
+				sys.setReorderInterval(reorder);
+				sys.addForce(&gravity);
+				sys.addForce(&turbulence);
+				RandomStream rng(1);
+				fill(sys.addBlock(n, neverExpiring()), n, rng);
+				BenchParams reorderParams = params;
+				reorderParams.push_back({ "reorder", (double)reorder });
+				runner.run("particles/update", reorderParams, (double)n * reorderPeriod, [&]() {
+					for (int k = 0; k < reorderPeriod; k++) sys.update(dt);
+				});
+			}
+
+			// forces fixed at compile time, one fused loop per chunk
+			//
+			if (runner.selected("particles/update_static")) {
+				StaticParticleSystem<GravityForce, TurbulenceForce> sys;
+				sys.setThreaded(threaded != 0);
+				sys.force<0>().set(ofVec3f(0, -1.62, 0));
+				sys.force<1>().set(ofVec3f(-2, 0, -2), ofVec3f(2, 0, 2));
+				RandomStream rng(1);
+				fill(sys.addBlock(n, neverExpiring()), n, rng);
+				runner.run("particles/update_static", params, n, [&]() { sys.update(dt); });
+			}
+
+			// turbulence in a sphere of radius 5 (about 6% of the cube) on top
+			// of the gravity everywhere, both orders again.  Only the particles
+			// on the region list are visited, see applyBoundedChunk(); the sort
+			// renumbers them, so with reorder the list is rebuilt every period.
+			//
+			for (int reorder : { 0, reorderPeriod }) {
+				if (!runner.selected("particles/update_bounded")) break;
+				ParticleSystem sys;
+				sys.setThreaded(threaded != 0);
+				sys.setReorderInterval(reorder);
+				TurbulenceForce local(ofVec3f(-2, 0, -2), ofVec3f(2, 0, 2));
+				local.setRegion(ofVec3f(0, 10, 0), 5, ParticleForce::SmoothFalloff);
+				sys.addForce(&gravity);
+				sys.addForce(&local);
+				RandomStream rng(1);
+				fill(sys.addBlock(n, neverExpiring()), n, rng);
+				BenchParams reorderParams = params;
+				reorderParams.push_back({ "reorder", (double)reorder });
+				runner.run("particles/update_bounded", reorderParams, (double)n * reorderPeriod, [&]() {
+					for (int k = 0; k < reorderPeriod; k++) sys.update(dt);
+				});
+			}
+
+			if (runner.selected("particles/update_compact")) {
+				CompactParticleSystem sys;
+				sys.setThreaded(threaded != 0);
+				sys.addForce(&gravity);
+				sys.addForce(&turbulence);
+				vector<Particle> staged(n, neverExpiring());
+				RandomStream rng(1);
+				fill(&staged[0], n, rng);
+				sys.add(&staged[0], n);
+				runner.run("particles/update_compact", params, n, [&]() { sys.update(dt); });
+			}
+		}
+	}
+}
+
+static void benchSpawn(BenchRunner &runner, bool quick) {
+	const char *names[] = { "directional", "radial", "sphere", "disc" };
+	const EmitterType types[] = { DirectionalEmitter, RadialEmitter, SphereEmitter, DiscEmitter };
+
+	vector<int> groups = { 100, 10000 };
+	if (!quick) groups.push_back(100000);
+
+	// every sample spawns into an empty system, the setup builds it
+	//
+	for (int group : groups) {
+		for (int t = 0; t < 4; t++) {
+			string name = string("emitter/spawn_") + names[t];
+			if (!runner.selected(name)) continue;
+
+			std::unique_ptr<ParticleSystem> sys;
+			std::unique_ptr<ParticleEmitter> emitter;
+			runner.run(name, { { "group", (double)group } }, group,
+				[&]() { emitter->spawnGroup(group, 0); },
+				[&]() {
+					emitter.reset();
+					sys.reset(new ParticleSystem());
+					emitter.reset(new ParticleEmitter(sys.get()));
+					emitter->setEmitterType(types[t]);
+					emitter->setVelocity(ofVec3f(0, -10, 0));
+					emitter->setRandomLife(true);
+					emitter->setLifespanRange(ofVec2f(0.5, 1.5));
+				});
+		}
+
+		// the ship's exhaust: disc emitter packing into a compact system
+		//
+		if (runner.selected("emitter/spawn_compact")) {
+			std::unique_ptr<CompactParticleSystem> sys;
+			std::unique_ptr<ParticleEmitter> emitter;
+			runner.run("emitter/spawn_compact", { { "group", (double)group } }, group,
+				[&]() { emitter->spawnGroup(group, 0); },
+				[&]() {
+					emitter.reset();
+					sys.reset(new CompactParticleSystem());
+					emitter.reset(new ParticleEmitter(sys.get()));
+					emitter->setEmitterType(DiscEmitter);
+					emitter->setVelocity(ofVec3f(0, -10, 0));
+					emitter->setRandomLife(true);
+					emitter->setLifespanRange(ofVec2f(0.5, 1.5));
+				});
+		}
+	}
+}
+
+void benchParticles(BenchRunner &runner, bool quick) {
+	vector<int> sizes = { 1000, 10000, 100000, 1000000 };
+	if (quick) sizes.pop_back();
+
+	benchUpdate(runner, sizes);
+	benchSpawn(runner, quick);
+}
@@ -0,0 +1,50 @@
+
+//  bench - microbenchmarks for the Octree and particle system hot paths.
+//
+//      bench [--out file.json] [--filter name] [--time sec] [--quick]
+//
+//      --out      where to write the results (default bench.json)
+//      --filter   only run cases whose name contains this, e.g. octree/ray
+//      --time     seconds spent per case (default .5)
+//      --quick    skip the largest meshes and particle counts
+//
+//  An openFrameworks project of its own with no window; on Linux build it
+//  with "make" in this directory (see config.make for OF_ROOT) and run
+//  "make RunRelease" or bin/bench.  Compare two runs with
+//
+//      python3 compare.py base.json new.json
+//
+
+#include "ofMain.h"
+#include "Bench.h"
+#include "BenchCases.h"
+
+int main(int argc, char *argv[]) {
+	BenchRunner runner;
+	string out = "bench.json";
+	bool quick = false;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--out" && hasValue) out = argv[++i];
+		else if (arg == "--filter" && hasValue) runner.filter = argv[++i];
+		else if (arg == "--time" && hasValue) runner.minTime = atof(argv[++i]);
+		else if (arg == "--quick") quick = true;
+		else {
+			cout << "usage: bench [--out file.json] [--filter name] [--time sec] [--quick]" << endl;
+			return 1;
+		}
+	}
+
+	benchOctree(runner, quick);
+	benchParticles(runner, quick);
+
+	if (runner.results.empty()) {
+		cout << "bench: no case matches \"" << runner.filter << "\"" << endl;
+		return 1;
+	}
+	if (!runner.writeJson(out)) return 1;
+	cout << runner.results.size() << " results written to " << out << endl;
+	return 0;
+}
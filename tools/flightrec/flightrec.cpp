@@ -0,0 +1,119 @@
+
+//  flightrec - inspect flight recordings (.flr) written by the game.
+//
+//      flightrec info  <file>                  columns, steps, duration
+//      flightrec stats <file>                  min / max / mean of every channel
+//      flightrec csv   <file> [column ...]     dump (all or some) columns as CSV
+//
+//  Built on its own, without openFrameworks:
+//
+//      g++ -std=c++14 -O2 -I src/recorder tools/flightrec/flightrec.cpp src/recorder/FlightRecordReader.cpp -o flightrec
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "FlightRecordReader.h"
+
+static const char *typeName(int type) {
+	switch (type) {
+	case flightrec::U8:  return "u8";
+	case flightrec::U32: return "u32";
+	case flightrec::F32: return "f32";
+	}
+	return "?";
+}
+
+static void info(const FlightRecordReader &rec) {
+	printf("version   %d\n", rec.version());
+	printf("steps     %llu in %d blocks\n", (unsigned long long)rec.rowCount(), rec.blockCount());
+	printf("dt        %g sec\n", rec.dt());
+	printf("duration  %.2f sec\n", rec.rowCount() * rec.dt());
+	for (int c = 0; c < rec.columnCount(); c++) {
+		const flightrec::ColumnDesc &col = rec.column(c);
+		printf("  %-12s %s x %d\n", col.name, typeName(col.type), col.components);
+	}
+}
+
+static void stats(const FlightRecordReader &rec) {
+	std::vector<float> values;
+	printf("%-14s %14s %14s %14s\n", "channel", "min", "max", "mean");
+	for (int c = 0; c < rec.columnCount(); c++) {
+		const flightrec::ColumnDesc &col = rec.column(c);
+		rec.readColumn(c, values);
+		for (int k = 0; k < col.components; k++) {
+			float lo = 0, hi = 0;
+			double sum = 0;
+			size_t n = 0;
+			for (size_t i = k; i < values.size(); i += col.components, n++) {
+				if (n == 0 || values[i] < lo) lo = values[i];
+				if (n == 0 || values[i] > hi) hi = values[i];
+				sum += values[i];
+			}
+			char name[32];
+			if (col.components == 1) snprintf(name, sizeof(name), "%s", col.name);
+			else snprintf(name, sizeof(name), "%s.%c", col.name, "xyzw"[std::min(k, 3)]);
+			printf("%-14s %14g %14g %14g\n", name, lo, hi, n ? sum / n : 0.0);
+		}
+	}
+}
+
+static int csv(const FlightRecordReader &rec, int argc, char **argv) {
+	std::vector<int> cols;
+	for (int i = 0; i < argc; i++) {
+		int c = rec.findColumn(argv[i]);
+		if (c < 0) {
+			fprintf(stderr, "flightrec: no column \"%s\"\n", argv[i]);
+			return 1;
+		}
+		cols.push_back(c);
+	}
+	if (cols.empty()) {
+		for (int c = 0; c < rec.columnCount(); c++) cols.push_back(c);
+	}
+
+	std::vector<std::vector<float> > values(cols.size());
+	for (size_t i = 0; i < cols.size(); i++) {
+		const flightrec::ColumnDesc &col = rec.column(cols[i]);
+		rec.readColumn(cols[i], values[i]);
+		for (int k = 0; k < col.components; k++) {
+			if (i || k) printf(",");
+			if (col.components == 1) printf("%s", col.name);
+			else printf("%s.%c", col.name, "xyzw"[std::min(k, 3)]);
+		}
+	}
+	printf("\n");
+
+	for (uint64_t r = 0; r < rec.rowCount(); r++) {
+		for (size_t i = 0; i < cols.size(); i++) {
+			int n = rec.column(cols[i]).components;
+			for (int k = 0; k < n; k++) {
+				if (i || k) printf(",");
+				printf("%.9g", values[i][r * n + k]);
+			}
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		fprintf(stderr, "usage: flightrec info|stats|csv <file> [column ...]\n");
+		return 2;
+	}
+	FlightRecordReader rec;
+	if (!rec.open(argv[2])) {
+		fprintf(stderr, "flightrec: %s\n", rec.getError().c_str());
+		return 1;
+	}
+	if (strcmp(argv[1], "info") == 0) info(rec);
+	else if (strcmp(argv[1], "stats") == 0) stats(rec);
+	else if (strcmp(argv[1], "csv") == 0) return csv(rec, argc - 3, argv + 3);
+	else {
+		fprintf(stderr, "flightrec: unknown command \"%s\"\n", argv[1]);
+		return 2;
+	}
+	return 0;
+}